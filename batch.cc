@@ -0,0 +1,271 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Batch solver: plans many instances in one process, on a pool of threads, so
+that a run over thousands of small instances does not pay the start of a
+process for each one.
+
+  batch input output_dir [--threads N] [--time-limit S] [--seed N]
+                         [--summary FILE]
+
+input is a directory, whose files are all taken as instances, or a manifest
+with the path of an instance per line (empty lines and lines starting with #
+are skipped, and relative paths start at the directory of the manifest). The
+plan of each instance goes to output_dir/NAME.out, NAME being the name of its
+file without the extension, and a line per instance to the summary
+(output_dir/summary.csv by default), with the columns instance, algorithm,
+days, time and optimal.
+
+Each instance gets its lower bounds and the best plan of DSATUR and RLF. If that
+one is not proven optimal, the search goes on from it on the same thread: the
+one of exh on the instances of up to auto_exact_films films, which its exact
+engine solves, and, given a time limit, the tabu search of mh on the rest, with
+the seed given (a random one by default). --time-limit is the budget of each
+instance, which stops its bounds and its search and leaves the other instances
+running. Each thread keeps its buffers, and the arenas of both engines, from an
+instance to the next. */
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <ostream>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounds.hh"
+#include "construct.hh"
+#include "control.hh"
+#include "exact.hh"
+#include "exh.hh"
+#include "festival.hh"
+#include "mh.hh"
+#include "writer.hh"
+using namespace std;
+namespace fs = filesystem;
+
+// What became of an instance. days is -1 if it failed, and error says why.
+struct Result {
+  string algorithm;
+  int days = -1;
+  double time = 0;
+  bool optimal = false;
+  string error;
+};
+
+/* Buffers and engines of a thread, kept from an instance to the next. text is
+the best plan of the instance in the output format, of `days` days, and the
+reports of the engines are discarded. */
+struct Workspace {
+  vector<int> rank;
+  vector<Day> plan, other;
+  string text;
+  int days;
+  mh::Solver heuristic;
+  exh::Solver search;
+  ostream discard{nullptr};
+};
+
+/* Returns the instances to plan: the files of a directory, in order, or the
+paths listed in a manifest. Throws a runtime_error if neither can be read. */
+vector<string> list_instances(const string &input) {
+  vector<string> paths;
+  if (fs::is_directory(input)) {
+    for (const fs::directory_entry &entry : fs::directory_iterator(input))
+      if (entry.is_regular_file())
+        paths.push_back(entry.path().string());
+    sort(paths.begin(), paths.end());
+    return paths;
+  }
+  ifstream manifest(input);
+  if (not manifest)
+    throw runtime_error(input + ": cannot open");
+  fs::path base = fs::path(input).parent_path();
+  string line;
+  while (getline(manifest, line)) {
+    while (not line.empty() and isspace((unsigned char)line.back()))
+      line.pop_back();
+    if (line.empty() or line[0] == '#')
+      continue;
+    fs::path path(line);
+    paths.push_back(path.is_absolute() ? line : (base / path).string());
+  }
+  return paths;
+}
+
+/* Plans an instance and writes its plan to a file, within a budget of seconds
+(0 for none). The tabu search starts from `seed`. */
+Result solve(const string &path, const string &output, double budget,
+             uint64_t seed, Workspace &w) {
+  double start = now();
+  set_thread_budget(budget);
+  Result result;
+  try {
+    Instance festival = read_instance(path);
+    Bounds bounds = lower_bounds(festival);
+    w.rank.resize(festival.f);
+    for (int i = 0; i < festival.f; ++i)
+      w.rank[i] = i;
+    w.plan = dsatur_plan(festival, w.rank);
+    result.algorithm = "dsatur";
+    if (int(w.plan.size()) > bounds.best()) {
+      w.other = rlf_plan(festival, w.rank);
+      if (w.other.size() < w.plan.size()) {
+        swap(w.plan, w.other);
+        result.algorithm = "rlf";
+      }
+    }
+    result.optimal = int(w.plan.size()) <= bounds.best();
+    w.days = w.plan.size();
+    format_plan(festival, title_width(festival), w.plan, w.days, now() - start,
+                w.text);
+
+    /* The engines are offered the plan, so they only hand over plans with
+    fewer days, which replace it. */
+    auto keep = [&w](int days, const string &text) {
+      if (days < w.days) {
+        w.days = days;
+        w.text = text;
+      }
+    };
+    if (not result.optimal and festival.f <= auto_exact_films) {
+      w.search.report = &w.discard;
+      w.search.offer_bound(w.days);
+      w.search.writer.open(keep, festival);
+      result.optimal = w.search.solve(festival, exh::Options(), start).optimal;
+      if (w.days < int(w.plan.size()))
+        result.algorithm = "exh";
+    } else if (not result.optimal and budget > 0) {
+      mh::Options options;
+      options.engine = "tabu";
+      options.seed = seed;
+      w.heuristic.report = &w.discard;
+      w.heuristic.offer_bound(w.days);
+      w.heuristic.writer.open(keep, festival);
+      result.optimal = w.heuristic.solve(festival, options, start).optimal;
+      if (w.days < int(w.plan.size()))
+        result.algorithm = "mh";
+    }
+    result.days = w.days;
+    if (not replace_file(output, w.text))
+      throw runtime_error(output + ": cannot write");
+  } catch (const exception &e) {
+    result.days = -1;
+    result.error = e.what();
+  }
+  result.time = now() - start;
+  return result;
+}
+
+// Returns a field of a CSV line, quoted if it has to be.
+string csv_field(const string &field) {
+  if (field.find_first_of(",\"\n") == string::npos)
+    return field;
+  string quoted = "\"";
+  for (char ch : field) {
+    if (ch == '"')
+      quoted += '"';
+    quoted += ch;
+  }
+  return quoted + '"';
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0]
+         << " input output_dir [--threads N] [--time-limit S] [--seed N]"
+            " [--summary FILE]"
+         << endl;
+    return 1;
+  }
+  string input = argv[1];
+  string output_dir = argv[2];
+  int threads = max(1u, thread::hardware_concurrency());
+  double time_limit = 0;
+  uint64_t seed = (uint64_t(random_device()()) << 32) | random_device()();
+  string summary_file = (fs::path(output_dir) / "summary.csv").string();
+  for (int i = 3; i < argc; ++i) {
+    string option = argv[i];
+    if (option == "--threads" and i + 1 < argc)
+      threads = max(1, atoi(argv[++i]));
+    else if (option == "--time-limit" and i + 1 < argc)
+      time_limit = atof(argv[++i]);
+    else if (option == "--seed" and i + 1 < argc)
+      seed = strtoull(argv[++i], nullptr, 10);
+    else if (option == "--summary" and i + 1 < argc)
+      summary_file = argv[++i];
+    else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+
+  double start_time = now();
+  handle_signals();
+  vector<string> paths, outputs;
+  try {
+    paths = list_instances(input);
+    fs::create_directories(output_dir);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  // two instances with the same name would write the same plan
+  map<string, string> owner;
+  for (const string &path : paths) {
+    string name = fs::path(path).stem().string() + ".out";
+    auto [it, added] = owner.emplace(name, path);
+    if (not added) {
+      cerr << path << " and " << it->second << " would both write " << name
+           << endl;
+      return 1;
+    }
+    outputs.push_back((fs::path(output_dir) / name).string());
+  }
+
+  /* The threads take the instances in order until they run out or the batch is
+  interrupted; the instances left are reported as not planned. */
+  vector<Result> results(paths.size());
+  atomic<int> next{0};
+  auto work = [&]() {
+    Workspace w;
+    for (int k = next++; k < int(paths.size()) and not stopping; k = next++)
+      results[k] = solve(paths[k], outputs[k], time_limit, seed, w);
+  };
+  vector<thread> pool;
+  for (int i = 1; i < threads; ++i)
+    pool.emplace_back(work);
+  work();
+  for (thread &t : pool)
+    t.join();
+
+  string summary = "instance,algorithm,days,time,optimal\n";
+  int failed = 0, optimal = 0;
+  char seconds[32];
+  for (int k = 0; k < int(paths.size()); ++k) {
+    const Result &r = results[k];
+    if (r.days < 0) {
+      ++failed;
+      cerr << paths[k] << ": "
+           << (r.error.empty() ? "not planned" : r.error) << endl;
+    }
+    optimal += r.optimal;
+    snprintf(seconds, sizeof seconds, "%.3f", r.time);
+    summary += csv_field(paths[k]) + ',' +
+               (r.days < 0 ? "error" : r.algorithm) + ',' +
+               (r.days < 0 ? "" : to_string(r.days)) + ',' + seconds + ',' +
+               (r.optimal ? "1" : "0") + '\n';
+  }
+  if (not replace_file(summary_file, summary)) {
+    cerr << "cannot write " << summary_file << endl;
+    return 1;
+  }
+  cerr << paths.size() << " instances, " << optimal << " optimal, " << failed
+       << " failed in " << now() - start_time << " s" << endl;
+  return failed > 0 ? 1 : 0;
+}
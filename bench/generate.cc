@@ -0,0 +1,174 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Generator of festival instances for the benchmarks. It writes to the standard
+output, in the festival input format, one of:
+
+  generate gnp N P C [--seed S]
+      N films, each pair of them restricted with probability P.
+  generate planted N K P C [--seed S]
+      N films split in K hidden groups; films of different groups are
+      restricted with probability P, and a film of each group is restricted
+      with all the others, so exactly K days are needed if there are enough
+      cinemas.
+  generate dimacs FILE C
+      The graph of a DIMACS colouring file ("p edge" and "e" lines).
+
+C is the number of cinemas: a small C makes the capacity the binding limit of
+the instance, a large one leaves only the restrictions. */
+
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+using Edge = pair<int, int>;
+
+// Writes an instance with n films, the given restrictions and c cinemas.
+void write_instance(int n, const vector<Edge> &edges, int c) {
+  string text = to_string(n) + '\n';
+  for (int i = 0; i < n; ++i)
+    text += "Film-" + to_string(i) + '\n';
+  text += to_string(edges.size()) + '\n';
+  for (const Edge &e : edges)
+    text += "Film-" + to_string(e.first) + " Film-" + to_string(e.second) + '\n';
+  text += to_string(c) + '\n';
+  for (int i = 0; i < c; ++i)
+    text += (i > 0 ? " Cinema-" : "Cinema-") + to_string(i);
+  text += '\n';
+  cout << text;
+}
+
+// Restrictions of a random G(n, p) graph.
+vector<Edge> gnp(int n, double p, mt19937_64 &rng) {
+  bernoulli_distribution restricted(p);
+  vector<Edge> edges;
+  for (int i = 0; i < n; ++i)
+    for (int j = i + 1; j < n; ++j)
+      if (restricted(rng))
+        edges.push_back({i, j});
+  return edges;
+}
+
+/* Restrictions of a random graph with a planted k-colouring: the films are
+dealt in k groups of (almost) the same size in a random order, only films of
+different groups are restricted, and the first film of each group is
+restricted with the first film of every other group. */
+vector<Edge> planted(int n, int k, double p, mt19937_64 &rng) {
+  vector<int> group(n);
+  for (int i = 0; i < n; ++i)
+    group[i] = i % k;
+  shuffle(group.begin(), group.end(), rng);
+  vector<int> first(k, -1);
+  for (int i = 0; i < n; ++i)
+    if (first[group[i]] < 0)
+      first[group[i]] = i;
+
+  bernoulli_distribution restricted(p);
+  vector<Edge> edges;
+  for (int i = 0; i < n; ++i)
+    for (int j = i + 1; j < n; ++j) {
+      if (group[i] == group[j])
+        continue;
+      bool clique = first[group[i]] == i and first[group[j]] == j;
+      if (clique or restricted(rng))
+        edges.push_back({i, j});
+    }
+  return edges;
+}
+
+/* Restrictions of a DIMACS graph. Vertices are numbered from 1; loops and
+repeated edges are dropped. */
+vector<Edge> dimacs(const string &path, int &n) {
+  ifstream in(path);
+  if (not in)
+    throw runtime_error(path + ": cannot open file");
+  vector<Edge> edges;
+  n = -1;
+  string line;
+  int line_number = 0;
+  while (getline(in, line)) {
+    ++line_number;
+    istringstream words(line);
+    string kind;
+    if (not(words >> kind) or kind == "c")
+      continue;
+    if (kind == "p") {
+      string format;
+      long long m;
+      if (not(words >> format >> n >> m) or n < 1)
+        throw runtime_error(path + ":" + to_string(line_number) +
+                            ": malformed problem line");
+    } else if (kind == "e") {
+      int u, v;
+      if (n < 0 or not(words >> u >> v) or u < 1 or v < 1 or u > n or v > n)
+        throw runtime_error(path + ":" + to_string(line_number) +
+                            ": malformed edge");
+      if (u != v)
+        edges.push_back({min(u, v) - 1, max(u, v) - 1});
+    }
+  }
+  if (n < 0)
+    throw runtime_error(path + ": no problem line");
+  sort(edges.begin(), edges.end());
+  edges.erase(unique(edges.begin(), edges.end()), edges.end());
+  return edges;
+}
+
+[[noreturn]] void usage(const char *name) {
+  cerr << "usage: " << name << " gnp N P C [--seed S]" << endl
+       << "       " << name << " planted N K P C [--seed S]" << endl
+       << "       " << name << " dimacs FILE C" << endl;
+  exit(1);
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2)
+    usage(argv[0]);
+  string kind = argv[1];
+  vector<string> args;
+  uint64_t seed = 1;
+  for (int i = 2; i < argc; ++i) {
+    if (string(argv[i]) == "--seed" and i + 1 < argc)
+      seed = strtoull(argv[++i], nullptr, 10);
+    else
+      args.push_back(argv[i]);
+  }
+  mt19937_64 rng(seed);
+
+  try {
+    int n, c;
+    vector<Edge> edges;
+    if (kind == "gnp" and args.size() == 3) {
+      n = stoi(args[0]);
+      c = stoi(args[2]);
+      edges = gnp(n, stod(args[1]), rng);
+    } else if (kind == "planted" and args.size() == 4) {
+      n = stoi(args[0]);
+      int k = stoi(args[1]);
+      if (k < 1 or k > n)
+        throw runtime_error("the number of groups must be between 1 and N");
+      c = stoi(args[3]);
+      edges = planted(n, k, stod(args[2]), rng);
+    } else if (kind == "dimacs" and args.size() == 2) {
+      edges = dimacs(args[0], n);
+      c = stoi(args[1]);
+    } else
+      usage(argv[0]);
+    if (n < 1 or c < 1)
+      throw runtime_error("the numbers of films and cinemas must be positive");
+    write_instance(n, edges, c);
+  } catch (const logic_error &) {
+    // a number that stoi or stod cannot read
+    usage(argv[0]);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,270 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Benchmark harness. Runs every solver on every instance and writes a CSV line
+per run to the standard output:
+
+  harness [--time-limit S] [--runs R] --solver NAME=COMMAND ... INSTANCE ...
+
+COMMAND is the path of a solver followed by its options, as in
+"mh=./mh --threads 4"; the instance and output files are inserted after the
+path. While a solver runs, its output file is polled to record when the first
+plan appears and when the best one does. A solver still running after the time
+limit gets a SIGTERM (and a SIGKILL if it does not stop in a few seconds); its
+last plan counts. Each final plan is checked against the instance. */
+
+#include <cmath>
+#include <csignal>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "../control.hh"
+#include "../festival.hh"
+using namespace std;
+
+struct Solver {
+  string name;
+  vector<string> command;
+};
+
+// What is measured of a run.
+struct Result {
+  int days = -1;
+  bool valid = false;
+  double first_time = NAN, best_time = NAN, wall_time = 0;
+  long peak_rss = 0;
+  string status;
+};
+
+// Seconds between polls of the output file, and after a SIGTERM.
+const double poll_interval = 0.005, kill_grace = 5;
+
+/* Returns the number of days of the plan in an output file, or -1 if there is
+no plan yet. The solvers replace the file atomically, so it is never partial. */
+int read_days(const string &path) {
+  ifstream in(path);
+  double time;
+  int days;
+  if (in >> time >> days)
+    return days;
+  return -1;
+}
+
+/* Returns true if the plan of an output file is a valid plan of the instance:
+every film projected once, no cinema used twice on a day and no restricted
+films on the same day. */
+bool check_plan(const Instance &festival, const string &path) {
+  unordered_map<string, int> film_index, cinema_index;
+  for (int i = 0; i < festival.f; ++i)
+    film_index[festival.titles[i]] = i;
+  for (int i = 0; i < festival.c; ++i)
+    cinema_index[festival.cinemas[i]] = i;
+
+  ifstream in(path);
+  double time;
+  int days;
+  if (not(in >> time >> days) or days < 1)
+    return false;
+  vector<Day> plan(days);
+  vector<int> cinema_day(size_t(days) * festival.c, -1);
+  vector<bool> planned(festival.f, false);
+  string title, cinema;
+  int day;
+  while (in >> title >> day >> cinema) {
+    auto film = film_index.find(title);
+    auto room = cinema_index.find(cinema);
+    if (film == film_index.end() or room == cinema_index.end() or day < 1 or
+        day > days or planned[film->second])
+      return false;
+    int &used = cinema_day[size_t(day - 1) * festival.c + room->second];
+    if (used >= 0)
+      return false;
+    used = film->second;
+    planned[film->second] = true;
+    plan[day - 1].push_back(film->second);
+  }
+  if (not in.eof())
+    return false;
+  for (bool p : planned)
+    if (not p)
+      return false;
+  for (const Day &films : plan)
+    for (int i = 0; i < int(films.size()); ++i)
+      for (int j = i + 1; j < int(films.size()); ++j)
+        if (festival.restricted(films[i], films[j]))
+          return false;
+  return true;
+}
+
+// Runs a solver on an instance, polling its output file until it finishes.
+Result run(const Solver &solver, const string &input, const Instance &festival,
+           const string &output, double time_limit) {
+  unlink(output.c_str());
+  vector<string> words = solver.command;
+  words.insert(words.begin() + 1, {input, output});
+  vector<char *> args;
+  for (string &word : words)
+    args.push_back(word.data());
+  args.push_back(nullptr);
+
+  Result result;
+  double start = now();
+  pid_t pid = fork();
+  if (pid < 0) {
+    result.status = "fork failed";
+    return result;
+  }
+  if (pid == 0) {
+    // the solvers report on stderr, which would mix with the CSV
+    freopen("/dev/null", "w", stdout);
+    freopen("/dev/null", "w", stderr);
+    execvp(args[0], args.data());
+    _exit(127);
+  }
+
+  int status = 0;
+  struct rusage usage = {};
+  double killed_at = -1;
+  struct timespec last_change = {0, 0};
+  ino_t last_inode = 0;
+  while (wait4(pid, &status, WNOHANG, &usage) == 0) {
+    double elapsed = now() - start;
+    struct stat st;
+    if (stat(output.c_str(), &st) == 0 and
+        (st.st_ino != last_inode or st.st_mtim.tv_sec != last_change.tv_sec or
+         st.st_mtim.tv_nsec != last_change.tv_nsec)) {
+      last_inode = st.st_ino;
+      last_change = st.st_mtim;
+      int days = read_days(output);
+      if (days > 0 and isnan(result.first_time))
+        result.first_time = elapsed;
+      if (days > 0 and (result.days < 0 or days < result.days)) {
+        result.days = days;
+        result.best_time = elapsed;
+      }
+    }
+    if (killed_at < 0 and elapsed > time_limit) {
+      kill(pid, SIGTERM);
+      killed_at = elapsed;
+    } else if (killed_at >= 0 and elapsed > killed_at + kill_grace)
+      kill(pid, SIGKILL);
+    this_thread::sleep_for(chrono::duration<double>(poll_interval));
+  }
+  result.wall_time = now() - start;
+  result.peak_rss = usage.ru_maxrss;
+
+  // the last plan can be written on exit, after the last poll
+  int days = read_days(output);
+  if (days > 0 and (result.days < 0 or days < result.days)) {
+    result.days = days;
+    result.best_time = result.wall_time;
+    if (isnan(result.first_time))
+      result.first_time = result.wall_time;
+  }
+  result.valid = days > 0 and check_plan(festival, output);
+
+  if (WIFSIGNALED(status))
+    result.status = "signal " + to_string(WTERMSIG(status));
+  else
+    result.status = "exit " + to_string(WEXITSTATUS(status));
+  if (killed_at >= 0)
+    result.status += " (time limit)";
+  return result;
+}
+
+// Splits a command on white space.
+vector<string> split(const string &command) {
+  istringstream in(command);
+  vector<string> words;
+  string word;
+  while (in >> word)
+    words.push_back(word);
+  return words;
+}
+
+// Writes a number with a fixed precision, or nothing if it is unknown.
+string seconds(double t) {
+  if (isnan(t))
+    return "";
+  char text[32];
+  snprintf(text, sizeof text, "%.3f", t);
+  return text;
+}
+
+int main(int argc, char **argv) {
+  double time_limit = 60;
+  int runs = 1;
+  vector<Solver> solvers;
+  vector<string> instances;
+  for (int i = 1; i < argc; ++i) {
+    string option = argv[i];
+    if (option == "--time-limit" and i + 1 < argc)
+      time_limit = atof(argv[++i]);
+    else if (option == "--runs" and i + 1 < argc)
+      runs = max(1, atoi(argv[++i]));
+    else if (option == "--solver" and i + 1 < argc) {
+      string spec = argv[++i];
+      size_t equal = spec.find('=');
+      Solver solver;
+      if (equal != string::npos) {
+        solver.name = spec.substr(0, equal);
+        solver.command = split(spec.substr(equal + 1));
+      }
+      if (solver.name.empty() or solver.command.empty()) {
+        cerr << "bad solver " << spec << ", expected NAME=COMMAND" << endl;
+        return 1;
+      }
+      solvers.push_back(solver);
+    } else
+      instances.push_back(option);
+  }
+  if (solvers.empty() or instances.empty()) {
+    cerr << "usage: " << argv[0]
+         << " [--time-limit S] [--runs R] --solver NAME=COMMAND ... INSTANCE ..."
+         << endl;
+    return 1;
+  }
+
+  char directory[] = "/tmp/festival-bench-XXXXXX";
+  if (mkdtemp(directory) == nullptr) {
+    cerr << "cannot create a temporary directory" << endl;
+    return 1;
+  }
+  string output = string(directory) + "/plan.txt";
+
+  cout << "instance,films,restrictions,cinemas,solver,run,days,valid,"
+          "first_solution_s,best_solution_s,wall_s,peak_rss_kb,status"
+       << endl;
+  for (const string &input : instances) {
+    Instance festival;
+    try {
+      festival = read_instance(input);
+    } catch (const exception &e) {
+      cerr << e.what() << endl;
+      continue;
+    }
+    for (const Solver &solver : solvers)
+      for (int r = 0; r < runs; ++r) {
+        Result result = run(solver, input, festival, output, time_limit);
+        cout << input << ',' << festival.f << ',' << festival.l << ','
+             << festival.c << ',' << solver.name << ',' << r + 1 << ','
+             << result.days << ',' << result.valid << ','
+             << seconds(result.first_time) << ',' << seconds(result.best_time)
+             << ',' << seconds(result.wall_time) << ',' << result.peak_rss
+             << ',' << result.status << endl;
+      }
+  }
+  unlink(output.c_str());
+  unlink((output + ".tmp").c_str());
+  rmdir(directory);
+}
@@ -0,0 +1,60 @@
+#!/bin/sh
+# Authors: Sergio Cárdenas & Adrián Cerezuela
+#
+# Generates the benchmark instances and runs the three solvers on them:
+#
+#   bench/suite.sh BIN_DIR [TIME_LIMIT] [DIMACS_FILE ...] > results.csv
+#
+# BIN_DIR holds the compiled exh, greedy, mh, generate and harness, e.g.
+#
+#   g++ -O2 -pthread -o BIN_DIR/mh mh.cc
+#   g++ -O2 -o BIN_DIR/generate bench/generate.cc
+#   g++ -O2 -o BIN_DIR/harness bench/harness.cc
+#
+# The instances go from sparse to dense restrictions, and from tight to loose
+# cinema counts; any DIMACS colouring files given are added with 4 and 64
+# cinemas.
+
+set -e
+if [ $# -lt 1 ]; then
+  echo "usage: $0 BIN_DIR [TIME_LIMIT] [DIMACS_FILE ...]" >&2
+  exit 1
+fi
+bin=$1
+limit=${2:-60}
+[ $# -ge 2 ] && shift 2 || shift
+instances=${INSTANCES:-bench/instances}
+mkdir -p "$instances"
+
+gen() {
+  name=$1
+  shift
+  [ -f "$instances/$name.txt" ] || "$bin/generate" "$@" > "$instances/$name.txt"
+}
+
+for n in 30 60 500 2000; do
+  for p in 0.1 0.5; do
+    for c in 2 8 64; do
+      gen "gnp-$n-$p-$c" gnp $n $p $c
+    done
+  done
+done
+for n in 60 500 2000; do
+  for k in 5 20; do
+    # n / k cinemas makes the planted colouring exactly fill every day
+    for c in $((n / k)) $((2 * n / k)); do
+      gen "planted-$n-$k-$c" planted $n $k 0.3 $c
+    done
+  done
+done
+for file in "$@"; do
+  base=$(basename "$file" .col)
+  gen "dimacs-$base-4" dimacs "$file" 4
+  gen "dimacs-$base-64" dimacs "$file" 64
+done
+
+"$bin/harness" --time-limit "$limit" \
+  --solver "greedy=$bin/greedy --time-limit $limit" \
+  --solver "mh=$bin/mh --seed 1 --time-limit $limit" \
+  --solver "exh=$bin/exh --time-limit $limit" \
+  "$instances"/*.txt
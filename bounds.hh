@@ -0,0 +1,123 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Lower bounds of the days of any plan of an instance, so that the solvers know
+when their plan is optimal:
+
+- capacity: a day projects at most c films, so at least ceil(f / c) days.
+- clique: the films of a clique (all of them restricted with each other) go to
+  different days. The clique is grown greedily from many films.
+- partition: if the films are split in m cliques, a day projects at most one
+  film of each, so at least ceil(f / min(c, m)) days. It beats the capacity
+  bound on instances with many restrictions.
+
+The cliques are grown on the lists of restrictions, so they work on sparse
+instances too. */
+
+#ifndef BOUNDS_HH
+#define BOUNDS_HH
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+#include "control.hh"
+#include "festival.hh"
+#include "trace.hh"
+using namespace std;
+
+struct Bounds {
+  int capacity = 0, clique = 0, partition = 0;
+  vector<int> largest_clique;
+
+  // Returns the best of the bounds.
+  int best() const { return max({capacity, clique, partition}); }
+};
+
+/* Grows a clique from a film among the films not taken: each time the
+candidate (a film restricted with every film of the clique) with most
+restrictions joins it, until there is no candidate left. */
+inline vector<int> grow_clique(const Instance &festival, int film,
+                               const vector<bool> &taken) {
+  vector<int> clique = {film}, candidates;
+  for (int j : festival.neighbours(film))
+    if (not taken[j])
+      candidates.push_back(j);
+  while (not candidates.empty()) {
+    int best = candidates[0];
+    for (int j : candidates)
+      if (festival.num_restrictions[j] > festival.num_restrictions[best])
+        best = j;
+    clique.push_back(best);
+    int kept = 0;
+    for (int j : candidates)
+      if (j != best and festival.restricted(best, j))
+        candidates[kept++] = j;
+    candidates.resize(kept);
+  }
+  return clique;
+}
+
+/* Computes the lower bounds of an instance. The clique is grown from every film
+with enough restrictions to beat the largest one found, most restricted first;
+the partition takes the films in the same order, growing a clique from each one
+not taken yet. Both loops give up when the search is asked to stop. */
+inline Bounds lower_bounds(const Instance &festival) {
+  TRACE_PHASE("bounds");
+  int f = festival.f, c = festival.c;
+  Bounds bounds;
+  bounds.capacity = (f + c - 1) / c;
+
+  vector<int> films(f);
+  for (int i = 0; i < f; ++i)
+    films[i] = i;
+  stable_sort(films.begin(), films.end(), [&](int a, int b) {
+    return festival.num_restrictions[a] > festival.num_restrictions[b];
+  });
+
+  vector<bool> taken(f, false);
+  for (int i : films) {
+    if (festival.num_restrictions[i] < int(bounds.largest_clique.size()) or
+        stop_requested())
+      break;
+    vector<int> clique = grow_clique(festival, i, taken);
+    if (clique.size() > bounds.largest_clique.size())
+      bounds.largest_clique = clique;
+  }
+  bounds.clique = bounds.largest_clique.size();
+
+  int cliques = 0;
+  for (int i : films) {
+    if (stop_requested())
+      return bounds;
+    if (taken[i])
+      continue;
+    for (int j : grow_clique(festival, i, taken))
+      taken[j] = true;
+    ++cliques;
+  }
+  bounds.partition = (f + min(c, cliques) - 1) / min(c, cliques);
+  return bounds;
+}
+
+// Writes the bounds of an instance to a stream, the standard error by default.
+inline void report_bounds(const Bounds &bounds, ostream &out = cerr) {
+  out << "lower bound: " << bounds.best() << " (capacity " << bounds.capacity
+      << ", clique " << bounds.clique << ", partition " << bounds.partition
+      << ")" << endl;
+}
+
+/* What a solver ended with: the days of its last plan and whether they are
+proven to be the fewest. */
+struct Outcome {
+  int days = 0;
+  bool optimal = false;
+};
+
+// Writes the days of the final plan and its gap to a lower bound.
+inline void report_gap(int lower_bound, int days, ostream &out = cerr) {
+  int gap = days - lower_bound;
+  out << "days: " << days << " (lower bound " << lower_bound << ", gap " << gap
+      << (gap == 0 ? ", optimal" : "") << ")" << endl;
+}
+
+#endif
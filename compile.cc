@@ -0,0 +1,46 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Compiles an instance to the binary format of festival.hh, so that the solvers
+can load it without parsing:
+
+  compile input output
+
+The input can be in the text format or already compiled. */
+
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "festival.hh"
+using namespace std;
+
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    cerr << "usage: " << argv[0] << " input output" << endl;
+    return 1;
+  }
+  string input_file = argv[1];
+  string output_file = argv[2];
+
+  Instance festival;
+  try {
+    festival = read_instance(input_file);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+
+  string buffer = binary_instance(festival);
+
+  // written to a temporary file first, so that the output is never partial
+  string temporary = output_file + ".tmp";
+  ofstream out(temporary, ios::binary | ios::trunc);
+  out.write(buffer.data(), buffer.size());
+  out.close();
+  if (not out or rename(temporary.c_str(), output_file.c_str()) != 0) {
+    cerr << "cannot write " << output_file << endl;
+    return 1;
+  }
+}
@@ -0,0 +1,248 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Constructive plans shared by the solvers. Both constructors place each film
+on a day without restrictions and with a free cinema, opening a day only when
+none is left, and break ties between films by a rank given by the caller (a
+random one gives a different plan each time):
+
+- DSATUR takes each time the film whose planned conflicts are spread over more
+  days (its saturation), then the one with more restrictions, and puts it on
+  the first day it fits.
+- RLF (recursive largest first) fills one day at a time: it starts with the
+  film with more unplanned conflicts and then adds the film with more conflicts
+  among the films that can no longer go on the day, until the day is full or no
+  film fits.
+
+Both use lazy heaps: an entry is pushed each time the key of a film changes and
+the outdated ones are skipped when they come out. */
+
+#ifndef CONSTRUCT_HH
+#define CONSTRUCT_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <queue>
+#include <string>
+#include <vector>
+
+#include "festival.hh"
+#include "trace.hh"
+using namespace std;
+
+// Ways of building the first plan of a solver.
+enum Construction { next_fit, dsatur, rlf };
+
+/* Reads the name of a construction ("next-fit", "dsatur" or "rlf"). Returns
+false if it is unknown. */
+inline bool parse_construction(const string &name, Construction &construction) {
+  if (name == "next-fit")
+    construction = next_fit;
+  else if (name == "dsatur")
+    construction = dsatur;
+  else if (name == "rlf")
+    construction = rlf;
+  else
+    return false;
+  return true;
+}
+
+// Entries taken out of the heaps, and the outdated ones among them.
+TRACE_COUNTER(trace_heap_pops, "construct.heap_pops");
+TRACE_COUNTER(trace_stale_pops, "construct.stale_pops");
+
+/* Entry of a lazy heap of films: the key of the film in the high half and its
+place in a fixed order of the films in the low half, so that ties go to the
+first film of the order. */
+inline uint64_t heap_entry(int key, int place, int f) {
+  return uint64_t(key) << 32 | uint32_t(f - 1 - place);
+}
+
+inline int entry_key(uint64_t entry) { return entry >> 32; }
+
+inline int entry_place(uint64_t entry, int f) {
+  return f - 1 - int(entry & 0xffffffff);
+}
+
+/* Set of pairs of numbers below 2^32 with open addressing, for up to `size`
+pairs. It is far faster than a node-based set on millions of pairs. */
+class Pair_set {
+public:
+  explicit Pair_set(size_t size) {
+    size_t slots = 16;
+    while (slots < 2 * size)
+      slots *= 2;
+    mask = slots - 1;
+    table.assign(slots, empty);
+  }
+
+  // Adds a pair, returning false if it was already in the set.
+  bool insert(uint32_t a, uint32_t b) {
+    uint64_t key = uint64_t(a) << 32 | b;
+    size_t slot = (key * 0x9e3779b97f4a7c15) >> 17 & mask;
+    while (table[slot] != empty) {
+      if (table[slot] == key)
+        return false;
+      slot = (slot + 1) & mask;
+    }
+    table[slot] = key;
+    return true;
+  }
+
+private:
+  static constexpr uint64_t empty = UINT64_MAX;
+  vector<uint64_t> table;
+  size_t mask;
+};
+
+/* Builds a plan with DSATUR. The saturation of a film counts the days with a
+conflict of it, so each pair (film, day) is counted once. Days only get full,
+so next_room[d] leads to the first day from d that has a free cinema (with path
+compression), and the first one without conflicts is found skipping at most
+one day per conflict of the film. rank must be a permutation of the films. */
+inline vector<Day> dsatur_plan(const Instance &festival,
+                               const vector<int> &rank) {
+  int f = festival.f, c = festival.c;
+  // ties of saturation go to the film with more restrictions, then by rank
+  vector<int> order(f), place(f);
+  for (int i = 0; i < f; ++i)
+    order[i] = i;
+  sort(order.begin(), order.end(), [&](int a, int b) {
+    if (festival.num_restrictions[a] != festival.num_restrictions[b])
+      return festival.num_restrictions[a] > festival.num_restrictions[b];
+    return rank[a] < rank[b];
+  });
+  for (int i = 0; i < f; ++i)
+    place[order[i]] = i;
+
+  vector<Day> plan;
+  vector<int> day_of(f, -1), saturation(f, 0), mark(f, -1), next_room(f + 1);
+  for (int d = 0; d <= f; ++d)
+    next_room[d] = d;
+  auto first_room = [&](int d) {
+    while (next_room[d] != d) {
+      next_room[d] = next_room[next_room[d]];
+      d = next_room[d];
+    }
+    return d;
+  };
+  Pair_set counted(festival.adjacency.size());
+
+  priority_queue<uint64_t> heap;
+  for (int i = 0; i < f; ++i)
+    heap.push(heap_entry(0, place[i], f));
+  while (not heap.empty()) {
+    uint64_t entry = heap.top();
+    heap.pop();
+    int film = order[entry_place(entry, f)];
+    TRACE_COUNT(trace_heap_pops);
+    if (day_of[film] >= 0 or entry_key(entry) != saturation[film]) {
+      TRACE_COUNT(trace_stale_pops);
+      continue;
+    }
+
+    for (int j : festival.neighbours(film))
+      if (day_of[j] >= 0)
+        mark[day_of[j]] = film;
+    int day = first_room(0);
+    while (day < int(plan.size()) and mark[day] == film)
+      day = first_room(day + 1);
+    if (day == int(plan.size()))
+      plan.emplace_back();
+    plan[day].push_back(film);
+    day_of[film] = day;
+    if (int(plan[day].size()) == c)
+      next_room[day] = day + 1;
+
+    for (int j : festival.neighbours(film))
+      if (day_of[j] < 0 and counted.insert(j, day)) {
+        ++saturation[j];
+        heap.push(heap_entry(saturation[j], place[j], f));
+      }
+  }
+  return plan;
+}
+
+/* Builds a plan with RLF. While a day is filled, blocked[film] is the day if
+the film is in conflict with a film of the day, and in_blocked counts the
+conflicts of each film with the blocked films. The films with no such conflict
+are taken by unplanned conflicts from a heap kept for all days; the blocked
+films that come out of it meanwhile are put back when the day is closed. A
+film is blocked at most once per day, and only on a day that gets one of its
+conflicts, so blocking a film j costs O(restrictions of j) at most that many
+times, instead of the O(f) scans per film of the textbook RLF. rank must be a
+permutation of the films. */
+inline vector<Day> rlf_plan(const Instance &festival, const vector<int> &rank) {
+  int f = festival.f, c = festival.c;
+  vector<int> order(f);
+  for (int i = 0; i < f; ++i)
+    order[rank[i]] = i;
+
+  vector<Day> plan;
+  vector<int> day_of(f, -1), unplanned(f), blocked(f, -1), in_blocked(f, 0);
+  priority_queue<uint64_t> by_conflicts;
+  for (int i = 0; i < f; ++i) {
+    unplanned[i] = festival.num_restrictions[i];
+    by_conflicts.push(heap_entry(unplanned[i], rank[i], f));
+  }
+
+  int planned = 0;
+  while (planned < f) {
+    int day = plan.size();
+    plan.emplace_back();
+    priority_queue<uint64_t> by_blocked;
+    vector<uint64_t> set_aside;
+    vector<int> touched;
+
+    while (int(plan[day].size()) < c) {
+      int film = -1;
+      while (film < 0 and not by_blocked.empty()) {
+        uint64_t entry = by_blocked.top();
+        by_blocked.pop();
+        int i = order[entry_place(entry, f)];
+        if (day_of[i] < 0 and blocked[i] != day and
+            entry_key(entry) == in_blocked[i])
+          film = i;
+      }
+      while (film < 0 and not by_conflicts.empty()) {
+        uint64_t entry = by_conflicts.top();
+        by_conflicts.pop();
+        int i = order[entry_place(entry, f)];
+        if (day_of[i] >= 0 or entry_key(entry) != unplanned[i])
+          continue;
+        if (blocked[i] == day)
+          set_aside.push_back(entry);
+        else
+          film = i;
+      }
+      if (film < 0)
+        break;
+
+      plan[day].push_back(film);
+      day_of[film] = day;
+      ++planned;
+      for (int j : festival.neighbours(film)) {
+        if (day_of[j] >= 0)
+          continue;
+        --unplanned[j];
+        by_conflicts.push(heap_entry(unplanned[j], rank[j], f));
+        if (blocked[j] == day)
+          continue;
+        blocked[j] = day;
+        for (int k : festival.neighbours(j))
+          if (day_of[k] < 0 and blocked[k] != day) {
+            if (in_blocked[k]++ == 0)
+              touched.push_back(k);
+            by_blocked.push(heap_entry(in_blocked[k], rank[k], f));
+          }
+      }
+    }
+
+    for (uint64_t entry : set_aside)
+      by_conflicts.push(entry);
+    for (int i : touched)
+      in_blocked[i] = 0;
+  }
+  return plan;
+}
+
+#endif
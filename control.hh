@@ -0,0 +1,173 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Wall clock and stopping conditions shared by the solvers. A search stops as
+soon as stop_requested() is true: after a SIGINT or SIGTERM, once its time limit
+has passed, or when the solver asks for it because it reached its target or a
+proven lower bound. */
+
+#ifndef CONTROL_HH
+#define CONTROL_HH
+
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <functional>
+#include <limits>
+#include <thread>
+using namespace std;
+
+// Returns the seconds of wall time on a monotonic clock.
+inline double now() {
+  return chrono::duration<double>(chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+// Why a search stopped.
+enum Stop_reason {
+  running,
+  finished,
+  bound_reached,
+  target_reached,
+  time_limit,
+  interrupted
+};
+
+inline atomic<bool> stopping{false};
+inline atomic<int> stop_reason{running};
+
+// Time (as returned by now()) after which the searches must stop.
+inline double deadline = numeric_limits<double>::infinity();
+
+/* Stopping state of the searches of some threads, apart from the others: batch
+runs give each instance its own, with its own time limit, so that an instance
+that reaches its bound or its budget leaves the others running. */
+struct Stop_scope {
+  atomic<bool> stopped{false};
+  atomic<int> reason{running};
+  double deadline = numeric_limits<double>::infinity();
+};
+
+/* Scope of the calling thread, or null if its searches only stop with the
+process. */
+inline thread_local Stop_scope *stop_scope = nullptr;
+
+/* Gives the searches of the calling thread a scope of their own, ending
+`seconds` from now (0 for no limit). */
+inline void set_thread_budget(double seconds) {
+  thread_local Stop_scope own;
+  own.stopped = false;
+  own.reason = running;
+  own.deadline = seconds > 0 ? now() + seconds
+                             : numeric_limits<double>::infinity();
+  stop_scope = &own;
+}
+
+/* Starts a thread running fn(args...) in the scope of the calling thread, so
+that the threads of a search stop together. */
+template <class Fn, class... Args>
+thread scoped_thread(Fn fn, Args... args) {
+  Stop_scope *scope = stop_scope;
+  return thread([=]() mutable {
+    stop_scope = scope;
+    invoke(fn, args...);
+  });
+}
+
+// Sets a stop flag, keeping the first reason given.
+inline void set_stop(atomic<bool> &flag, atomic<int> &why,
+                     Stop_reason reason) {
+  int expected = running;
+  why.compare_exchange_strong(expected, reason);
+  flag = true;
+}
+
+/* Asks the searches of the scope of the calling thread (every search, if it has
+none) to stop, keeping the first reason given. */
+inline void request_stop(Stop_reason reason) {
+  if (stop_scope)
+    set_stop(stop_scope->stopped, stop_scope->reason, reason);
+  else
+    set_stop(stopping, stop_reason, reason);
+}
+
+/* Lowers an atomic bound shared by several threads to `value`, unless it is
+already lower. */
+inline void lower_bound_to(atomic<int> &bound, int value) {
+  int current = bound;
+  while (value < current and not bound.compare_exchange_weak(current, value)) {
+  }
+}
+
+// Stops the searches whose time limit has passed at time t.
+inline void check_deadlines(double t) {
+  if (t >= deadline)
+    set_stop(stopping, stop_reason, time_limit);
+  if (stop_scope and t >= stop_scope->deadline)
+    set_stop(stop_scope->stopped, stop_scope->reason, time_limit);
+}
+
+/* Returns true if the searches of the calling thread were asked to stop,
+without looking at the clock. */
+inline bool stop_flagged() {
+  return stopping.load(memory_order_relaxed) or
+         (stop_scope and stop_scope->stopped.load(memory_order_relaxed));
+}
+
+/* Returns true if the searches must stop. Reading the clock is not free, so the
+time limit is only checked once every 1024 calls of each thread. */
+inline bool stop_requested() {
+  if (stop_flagged())
+    return true;
+  thread_local unsigned calls = 0;
+  if (++calls % 1024 == 0)
+    check_deadlines(now());
+  return stop_flagged();
+}
+
+/* Like stop_requested, but checking the time limits on every call, for loops
+whose steps are long. */
+inline bool stop_requested_now() {
+  if (not stop_flagged())
+    check_deadlines(now());
+  return stop_flagged();
+}
+
+/* Returns why the searches of the calling thread stopped, or running if they
+were not asked to. */
+inline Stop_reason current_stop_reason() {
+  int reason = stop_scope ? int(stop_scope->reason) : running;
+  return Stop_reason(reason != running ? reason : int(stop_reason));
+}
+
+// A signal stops every search, whatever its scope.
+inline void on_signal(int) { set_stop(stopping, stop_reason, interrupted); }
+
+/* Makes SIGINT and SIGTERM stop the searches so that the solver can write its
+best plan and exit cleanly. A second signal kills the process. */
+inline void handle_signals() {
+  struct sigaction action = {};
+  action.sa_handler = on_signal;
+  action.sa_flags = SA_RESETHAND;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGINT, &action, nullptr);
+  sigaction(SIGTERM, &action, nullptr);
+}
+
+// Returns a description of the reason why the searches stopped.
+inline const char *stop_description() {
+  switch (current_stop_reason()) {
+  case running:
+  case finished:
+    return "search finished";
+  case bound_reached:
+    return "lower bound reached";
+  case target_reached:
+    return "target reached";
+  case time_limit:
+    return "time limit reached";
+  default:
+    return "interrupted";
+  }
+}
+
+#endif
@@ -0,0 +1,515 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Solver daemon: keeps the instances it is given parsed, and plans them on
+request over a Unix socket, so that an interactive tool pays neither the start
+of a process nor the parsing of its instance on every request.
+
+  daemon socket [--cache N] [--time-limit S]
+
+A client sends requests a line at a time, and the daemon answers each one with
+a line, or with error MESSAGE if it cannot be done:
+
+  instance BYTES         followed by BYTES of an instance (in the text format
+                         or compiled). Answers instance ID FILMS CINEMAS.
+  delta ID BYTES         followed by BYTES of a delta file (see replan.hh),
+                         applied to the instance ID. Answers as instance.
+  solve ID SOLVER ARGS   plans the instance ID with greedy, mh or exh, given
+                         the options of its command line. Each improved plan
+                         is sent as plan BYTES followed by BYTES of the plan
+                         in the output format, each line the solver reports
+                         (its times, bounds and statistics) as report LINE,
+                         and the solve ends with
+                         done DAYS optimal|feasible REASON. The first report
+                         of mh is report seed: N, the seed that repeats the
+                         solve when given as --seed N.
+
+An instance is known by the hash of its bytes (or of the instance and the
+delta it comes from), so sending one again costs no parsing: its bytes are kept
+with it, and another instance whose bytes have the same hash gets the next id
+that is free. The last N instances used are kept (16 by default), and none may
+take more than 256 MiB. A solve stops at its --time-limit, or at the one of the
+daemon if it has none (10 s by default, 0 for none); any line sent during a
+solve, such as stop, ends it early, and the plans found so far stand.
+
+Each solve runs on a thread of the daemon with a stop scope of its own, so that
+its time limit and its stop leave the other solves running. The engines of mh
+and exh are kept with the instance, and a solve reuses their arenas unless
+another solve of the same instance is using them. */
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "control.hh"
+#include "exh.hh"
+#include "festival.hh"
+#include "greedy.hh"
+#include "mh.hh"
+#include "replan.hh"
+using namespace std;
+
+// Most bytes of an instance or delta taken in a request (256 MiB).
+const size_t max_request_bytes = size_t(1) << 28;
+
+/* Engines of an instance, kept from a solve to the next so that they reuse
+their arenas. busy is held by the solve using them. */
+struct Engines {
+  mutex busy;
+  mh::Solver heuristic;
+  exh::Solver search;
+};
+
+/* What the daemon keeps of an instance: the bytes that identify it (its own,
+or the id of the instance and the delta it comes from), the instance and its
+engines. */
+struct Entry {
+  string key;
+  shared_ptr<const Instance> festival;
+  shared_ptr<Engines> engines = make_shared<Engines>();
+};
+
+// Returns the FNV-1a hash of some bytes, starting from a given hash.
+uint64_t hash_bytes(string_view data,
+                    uint64_t hash = 0xcbf29ce484222325) {
+  for (unsigned char ch : data) {
+    hash ^= ch;
+    hash *= 0x100000001b3;
+  }
+  return hash;
+}
+
+/* Instances known to the daemon, by their id, of which the last `capacity`
+used are kept. The id of some bytes is their hash, or the next one that no
+other bytes take. */
+class Instance_cache {
+public:
+  explicit Instance_cache(size_t capacity) : capacity(capacity) {}
+
+  // Returns the entry of an id, or nullptr if it is not kept.
+  shared_ptr<Entry> find(uint64_t id) {
+    lock_guard<mutex> guard(lock);
+    auto it = entries.find(id);
+    if (it == entries.end())
+      return nullptr;
+    recent.splice(recent.begin(), recent, it->second.second);
+    return it->second.first;
+  }
+
+  /* Returns the entry of some bytes, given their hash, or nullptr if they are
+  not kept. */
+  shared_ptr<Entry> find(const string &key, uint64_t hash) {
+    lock_guard<mutex> guard(lock);
+    auto it = probe(key, hash);
+    if (it == entries.end())
+      return nullptr;
+    recent.splice(recent.begin(), recent, it->second.second);
+    return it->second.first;
+  }
+
+  /* Keeps an entry, given the hash of its key, dropping the one used longest
+  ago if the cache is full, and returns its id. If another one with the same
+  key was kept meanwhile, entry becomes that one. */
+  uint64_t add(shared_ptr<Entry> &entry, uint64_t hash) {
+    lock_guard<mutex> guard(lock);
+    auto it = probe(entry->key, hash);
+    if (it != entries.end()) {
+      entry = it->second.first;
+      recent.splice(recent.begin(), recent, it->second.second);
+      return it->first;
+    }
+    if (entries.size() == capacity) {
+      entries.erase(recent.back());
+      recent.pop_back();
+    }
+    uint64_t id = hash;
+    while (entries.count(id))
+      ++id;
+    recent.push_front(id);
+    entries[id] = {entry, recent.begin()};
+    return id;
+  }
+
+private:
+  using Map = unordered_map<uint64_t,
+                            pair<shared_ptr<Entry>, list<uint64_t>::iterator>>;
+
+  /* Returns the entry of some bytes, looking from the id of their hash until
+  the first one that is free, or the end of the map if none has them. */
+  Map::iterator probe(const string &key, uint64_t hash) {
+    for (uint64_t id = hash;; ++id) {
+      auto it = entries.find(id);
+      if (it == entries.end() or it->second.first->key == key)
+        return it;
+    }
+  }
+
+  size_t capacity;
+  mutex lock;
+  list<uint64_t> recent;
+  Map entries;
+};
+
+Instance_cache *cache;
+
+// Time limit of the solves that do not give one.
+double default_time_limit = 10;
+
+// Connections being served, so that the daemon waits for them to end.
+atomic<int> connections{0};
+
+string id_text(uint64_t id) {
+  char text[17];
+  snprintf(text, sizeof text, "%016llx", (unsigned long long)id);
+  return text;
+}
+
+/* Connection of a client. Requests are read a line at a time, and the bytes of
+an instance or a delta after their line. Reading gives up when the daemon is
+stopped. The answers can be sent from several threads, as the plans of a
+solve are sent by its writer while the solver reports. */
+class Connection {
+public:
+  explicit Connection(int fd) : fd(fd) {}
+  ~Connection() { close(fd); }
+  Connection(const Connection &) = delete;
+  Connection &operator=(const Connection &) = delete;
+
+  // Reads a line without its end. Returns false if the client is gone.
+  bool read_line(string &line) {
+    size_t end;
+    while ((end = buffer.find('\n')) == string::npos)
+      if (not fill())
+        return false;
+    line = buffer.substr(0, end);
+    if (not line.empty() and line.back() == '\r')
+      line.pop_back();
+    buffer.erase(0, end + 1);
+    return true;
+  }
+
+  // Reads n bytes. Returns false if the client is gone first.
+  bool read_bytes(size_t n, string &data) {
+    while (buffer.size() < n)
+      if (not fill())
+        return false;
+    data = buffer.substr(0, n);
+    buffer.erase(0, n);
+    return true;
+  }
+
+  // Sends all of a text, whole. Returns false if the client is gone.
+  bool send(string_view text) {
+    lock_guard<mutex> guard(send_lock);
+    while (not text.empty()) {
+      ssize_t n = ::send(fd, text.data(), text.size(), MSG_NOSIGNAL);
+      if (n < 0 and errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      text.remove_prefix(n);
+    }
+    return true;
+  }
+
+  /* Returns true if the client has sent something (or is gone) within some
+  milliseconds. */
+  bool readable(int milliseconds) {
+    if (not buffer.empty())
+      return true;
+    pollfd p = {fd, POLLIN, 0};
+    return poll(&p, 1, milliseconds) > 0;
+  }
+
+private:
+  // Reads more bytes into the buffer, checking now and then for a stop.
+  bool fill() {
+    while (not stopping) {
+      pollfd p = {fd, POLLIN, 0};
+      if (poll(&p, 1, 200) <= 0)
+        continue;
+      char chunk[1 << 16];
+      ssize_t n = recv(fd, chunk, sizeof chunk, 0);
+      if (n < 0 and errno == EINTR)
+        continue;
+      if (n <= 0)
+        return false;
+      buffer.append(chunk, n);
+      return true;
+    }
+    return false;
+  }
+
+  const int fd;
+  string buffer;
+  mutex send_lock;
+};
+
+/* Stream buffer that sends each line written to it to a client as
+report LINE. */
+class Report_buffer : public streambuf {
+public:
+  explicit Report_buffer(Connection &connection) : connection(connection) {}
+
+protected:
+  int overflow(int ch) override {
+    if (ch == traits_type::eof())
+      return 0;
+    if (ch == '\n') {
+      connection.send("report " + line + "\n");
+      line.clear();
+    } else
+      line += char(ch);
+    return ch;
+  }
+
+private:
+  Connection &connection;
+  string line;
+};
+
+/* Plans an instance on a thread of its own, sending its plans, its reports and
+its end to the client, and waits for it. Any line the client sends meanwhile
+stops it, as does the client going away or a stop of the daemon. */
+void solve(Connection &connection, const Entry &entry, const string &solver,
+           const vector<string> &args) {
+  if (find(args.begin(), args.end(), "--trace") != args.end())
+    throw runtime_error("--trace is not taken by the daemon");
+  const Instance &festival = *entry.festival;
+  // a second solve of the instance at once gets engines of its own
+  unique_lock<mutex> warm(entry.engines->busy, try_to_lock);
+  unique_ptr<Engines> cold;
+  if (not warm.owns_lock())
+    cold = make_unique<Engines>();
+  Engines &engines = cold ? *cold : *entry.engines;
+
+  Stop_scope scope;
+  double start = now();
+  auto limit = [&](double time_limit) {
+    double seconds = time_limit > 0 ? time_limit : default_time_limit;
+    if (seconds > 0)
+      scope.deadline = start + seconds;
+  };
+  /* the writer calls the sink from a thread outside the scope, so a client
+  that is gone stops the solve through the scope itself */
+  auto sink = [&](int, const string &plan) {
+    if (not connection.send("plan " + to_string(plan.size()) + "\n" + plan))
+      set_stop(scope.stopped, scope.reason, interrupted);
+  };
+  Report_buffer lines(connection);
+  ostream report(&lines);
+  Outcome outcome;
+  string error, reason;
+  atomic<bool> finished{false};
+  thread worker([&]() {
+    stop_scope = &scope;
+    try {
+      if (solver == "greedy") {
+        greedy::Options options = greedy::parse_options(args);
+        limit(options.time_limit);
+        greedy::Solver engine;
+        engine.writer.open(sink, festival);
+        engine.report = &report;
+        outcome = engine.solve(festival, options, start);
+      } else if (solver == "mh") {
+        mh::Options options = mh::parse_options(args);
+        limit(options.time_limit);
+        engines.heuristic.writer.open(sink, festival);
+        engines.heuristic.report = &report;
+        outcome = engines.heuristic.solve(festival, options, start);
+      } else if (solver == "exh") {
+        exh::Options options = exh::parse_options(args);
+        limit(options.time_limit);
+        engines.search.writer.open(sink, festival);
+        engines.search.report = &report;
+        outcome = engines.search.solve(festival, options, start);
+      } else
+        throw runtime_error("unknown solver '" + solver + "'");
+    } catch (const exception &e) {
+      error = e.what();
+    }
+    reason = stop_description();
+    finished = true;
+  });
+
+  bool stopped = false;
+  while (not finished) {
+    if (stopped)
+      this_thread::sleep_for(chrono::milliseconds(20));
+    else if (connection.readable(20) or stopping) {
+      set_stop(scope.stopped, scope.reason, interrupted);
+      stopped = true;
+    }
+  }
+  worker.join();
+  if (not error.empty())
+    throw runtime_error(error);
+  connection.send("done " + to_string(outcome.days) + " " +
+                  (outcome.optimal ? "optimal " : "feasible ") + reason +
+                  "\n");
+}
+
+// Returns an entry of the cache, or throws a runtime_error if it is not.
+shared_ptr<Entry> cached(const string &id) {
+  char *end;
+  uint64_t key = strtoull(id.c_str(), &end, 16);
+  shared_ptr<Entry> entry;
+  if (not id.empty() and *end == '\0')
+    entry = cache->find(key);
+  if (entry == nullptr)
+    throw runtime_error("unknown instance " + id);
+  return entry;
+}
+
+// Returns the bytes announced by a request, or 0 if they are not a number.
+size_t request_bytes(const string &bytes) {
+  if (bytes.empty() or bytes.size() > 10 or
+      bytes.find_first_not_of("0123456789") != string::npos)
+    return 0;
+  size_t n = stoull(bytes);
+  return n <= max_request_bytes ? n : 0;
+}
+
+/* Answers with the id of the instance of some bytes, keeping it in the cache
+unless it is kept already: parse(key) returns it. */
+template <class Parse>
+bool answer_instance(Connection &connection, string key, Parse parse) {
+  uint64_t hash = hash_bytes(key);
+  shared_ptr<Entry> entry = cache->find(key, hash);
+  if (entry == nullptr) {
+    entry = make_shared<Entry>();
+    entry->festival = make_shared<const Instance>(parse(key));
+    entry->key = move(key);
+  }
+  uint64_t id = cache->add(entry, hash);
+  return connection.send("instance " + id_text(id) + " " +
+                         to_string(entry->festival->f) + " " +
+                         to_string(entry->festival->c) + "\n");
+}
+
+// Serves the requests of a client until it is gone or the daemon stops.
+void serve(int fd) {
+  Connection connection(fd);
+  string line, data;
+  while (connection.read_line(line)) {
+    istringstream in(line);
+    vector<string> words;
+    for (string word; in >> word;)
+      words.push_back(word);
+    // a stop that arrives after its solve has ended is ignored
+    if (words.empty() or words[0] == "stop")
+      continue;
+    bool sent = true;
+    try {
+      if ((words[0] == "instance" and words.size() == 2) or
+          (words[0] == "delta" and words.size() == 3)) {
+        size_t n = request_bytes(words.back());
+        if (n == 0) {
+          // the bytes that follow cannot be told from the next request
+          connection.send("error bad size " + words.back() + "\n");
+          return;
+        }
+        if (not connection.read_bytes(n, data))
+          return;
+        if (words[0] == "instance")
+          sent = answer_instance(connection, move(data), [](const string &key) {
+            return parse_instance(key, "instance");
+          });
+        else {
+          shared_ptr<Entry> base = cached(words[1]);
+          string key = "delta " + words[1] + "\n" + data;
+          sent = answer_instance(connection, move(key), [&](const string &) {
+            vector<int> old_film;
+            return apply_delta(*base->festival, data, "delta", old_film);
+          });
+        }
+      } else if (words[0] == "solve" and words.size() >= 3) {
+        shared_ptr<Entry> entry = cached(words[1]);
+        solve(connection, *entry, words[2],
+              vector<string>(words.begin() + 3, words.end()));
+      } else
+        throw runtime_error("unknown request '" + line + "'");
+    } catch (const exception &e) {
+      sent = connection.send(string("error ") + e.what() + "\n");
+    }
+    if (not sent)
+      return;
+  }
+}
+
+int main(int argc, char **argv) {
+  if (argc < 2) {
+    cerr << "usage: " << argv[0] << " socket [--cache N] [--time-limit S]"
+         << endl;
+    return 1;
+  }
+  string path = argv[1];
+  size_t capacity = 16;
+  for (int i = 2; i < argc; ++i) {
+    string option = argv[i];
+    if (option == "--cache" and i + 1 < argc)
+      capacity = max(1, atoi(argv[++i]));
+    else if (option == "--time-limit" and i + 1 < argc)
+      default_time_limit = atof(argv[++i]);
+    else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+
+  sockaddr_un address = {};
+  address.sun_family = AF_UNIX;
+  if (path.size() >= sizeof address.sun_path) {
+    cerr << path << ": socket path too long" << endl;
+    return 1;
+  }
+  strcpy(address.sun_path, path.c_str());
+  // a socket left by a daemon that did not end cleanly is replaced
+  struct stat st;
+  if (stat(path.c_str(), &st) == 0 and S_ISSOCK(st.st_mode))
+    unlink(path.c_str());
+  int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (listener < 0 or
+      bind(listener, (sockaddr *)&address, sizeof address) != 0 or
+      listen(listener, 16) != 0) {
+    cerr << path << ": cannot listen: " << strerror(errno) << endl;
+    return 1;
+  }
+  Instance_cache instances(capacity);
+  cache = &instances;
+  handle_signals();
+  cerr << "listening on " << path << endl;
+
+  while (not stopping) {
+    pollfd p = {listener, POLLIN, 0};
+    if (poll(&p, 1, 200) <= 0)
+      continue;
+    int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0)
+      continue;
+    ++connections;
+    thread([fd]() {
+      serve(fd);
+      --connections;
+    }).detach();
+  }
+  close(listener);
+  unlink(path.c_str());
+  while (connections > 0)
+    this_thread::sleep_for(chrono::milliseconds(20));
+}
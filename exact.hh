@@ -0,0 +1,198 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Exact plans of small instances by inclusion-exclusion over the sets of
+films, in O(2^f f) time instead of the tree of the exhaustive search.
+
+A day is a set of films with no restriction among them and at most c films.
+For every set X, i(X) counts the days inside X (the empty one too), so i(X)^k
+counts the k-tuples of days inside X, and
+
+  N_k(S) = sum over X in S of (-1)^|S \ X| i(X)^k
+
+counts the k-tuples of days that cover S exactly: S fits in k days if and only
+if N_k(S) > 0. The days needed are the least k with N_k(all films) > 0. The
+counts are taken modulo a prime of 61 bits, so a count that is not 0 proves
+that the films fit. A count of 0 is taken again modulo a second prime, of 31
+bits, and k days are only ruled out if it is 0 there too: the plan is then not
+the fewest days only if N_k is a multiple of both primes. If the second count
+is not 0, the first one cannot rebuild the plan and the engine gives up.
+
+The plan is rebuilt a day at a time: the first film left goes on a day T with
+N_{k-1}(left \ T) > 0, which is computed for every subset of the films left
+with one more transform. */
+
+#ifndef EXACT_HH
+#define EXACT_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "control.hh"
+#include "festival.hh"
+#include "trace.hh"
+using namespace std;
+
+/* The exact engine takes instances of up to max_exact_films films: it keeps 13
+bytes for each set of films. It takes some 0.1 s at 20 films and four times
+longer with each two more, so it is only chosen by default up to
+auto_exact_films. */
+const int max_exact_films = 24, auto_exact_films = 20;
+
+const uint64_t exact_prime = (uint64_t(1) << 61) - 1;
+const uint64_t check_prime = (uint64_t(1) << 31) - 1;
+
+inline uint64_t add_mod(uint64_t a, uint64_t b) {
+  uint64_t r = a + b;
+  return r >= exact_prime ? r - exact_prime : r;
+}
+
+inline uint64_t sub_mod(uint64_t a, uint64_t b) {
+  return a >= b ? a - b : a + exact_prime - b;
+}
+
+inline uint64_t mul_mod(uint64_t a, uint64_t b) {
+  unsigned __int128 x = (unsigned __int128)a * b;
+  uint64_t r = (uint64_t(x) & exact_prime) + uint64_t(x >> 61);
+  return r >= exact_prime ? r - exact_prime : r;
+}
+
+inline uint64_t pow_mod(uint64_t a, int k) {
+  uint64_t r = 1;
+  for (; k > 0; k >>= 1, a = mul_mod(a, a))
+    if (k & 1)
+      r = mul_mod(r, a);
+  return r;
+}
+
+/* Returns N_k(all films) modulo check_prime, given i(X) for every set X of the
+n films. */
+inline uint64_t check_count(const vector<uint32_t> &count, int n, int k) {
+  uint64_t sum = 0;
+  for (uint32_t x = 0; x < count.size(); ++x) {
+    uint64_t power = 1, base = count[x] % check_prime;
+    for (int e = k; e > 0; e >>= 1, base = base * base % check_prime)
+      if (e & 1)
+        power = power * base % check_prime;
+    if ((n - __builtin_popcount(x)) & 1)
+      power = check_prime - power;
+    sum = (sum + power) % check_prime;
+  }
+  return sum;
+}
+
+/* Applies op(a[X], a[X \ {x}]) for every element x and every set X with x, in
+the order of the elements, to the first `size` (a power of 2) values of a. The
+first elements are done a block at a time, so that the block stays in the
+cache instead of passing over the whole array once per element. */
+template <class T, class Op>
+void subset_transform(vector<T> &a, uint32_t size, Op op) {
+  const uint32_t block = min(size, uint32_t(1) << 12);
+  for (uint32_t start = 0; start < size; start += block)
+    for (uint32_t bit = 1; bit < block; bit <<= 1)
+      for (uint32_t x = start; x < start + block; x += 2 * bit)
+        for (uint32_t y = x; y < x + bit; ++y)
+          op(a[y + bit], a[y]);
+  for (uint32_t bit = block; bit < size; bit <<= 1)
+    for (uint32_t x = 0; x < size; x += 2 * bit)
+      for (uint32_t y = x; y < x + bit; ++y)
+        op(a[y + bit], a[y]);
+}
+
+/* Finds a plan of the fewest days of an instance of at most max_exact_films
+films, given a lower bound of its days. Returns false if the search is asked to
+stop first, or if a count that was a multiple of the first prime misled it. */
+inline bool exact_plan(const Instance &festival, int lower_bound,
+                       vector<Day> &plan) {
+  TRACE_PHASE("exact");
+  int n = festival.f, c = festival.c;
+  uint32_t all = (uint32_t(1) << n) - 1;
+  plan.clear();
+  if (n == 0)
+    return true;
+  vector<uint32_t> conflicts(n, 0);
+  for (int i = 0; i < n; ++i)
+    for (int j : festival.neighbours(i))
+      conflicts[i] |= uint32_t(1) << j;
+
+  /* day[X] tells if X can be a day, and count[X] is then i(X), by a transform
+  over each film. The sets with their films in order are built from the ones
+  without their first film. */
+  vector<uint8_t> day(size_t(all) + 1);
+  vector<uint32_t> count(size_t(all) + 1);
+  day[0] = 1;
+  for (uint32_t x = 1; x <= all; ++x) {
+    uint32_t rest = x & (x - 1);
+    day[x] = day[rest] and (conflicts[__builtin_ctz(x)] & rest) == 0 and
+             __builtin_popcount(x) <= c;
+  }
+  for (uint32_t x = 0; x <= all; ++x)
+    count[x] = day[x];
+  subset_transform(count, all + 1, [](uint32_t &a, uint32_t b) { a += b; });
+  if (stop_requested_now())
+    return false;
+
+  /* power[X] = (-1)^|all \ X| i(X)^k, so that N_k(all films) is their sum,
+  while k grows until it is not 0 */
+  vector<uint64_t> power(size_t(all) + 1);
+  int k = max(lower_bound, 1);
+  for (uint32_t x = 0; x <= all; ++x) {
+    power[x] = pow_mod(count[x], k);
+    if ((n - __builtin_popcount(x)) & 1)
+      power[x] = sub_mod(0, power[x]);
+  }
+  while (true) {
+    if (stop_requested_now() or k > n)
+      return false;
+    uint64_t sum = 0;
+    for (uint32_t x = 0; x <= all; ++x) {
+      sum = add_mod(sum, power[x]);
+      power[x] = mul_mod(power[x], count[x]);
+    }
+    if (sum != 0)
+      break;
+    if (check_count(count, n, k) != 0)
+      return false;
+    ++k;
+  }
+
+  /* The subsets of the films left, in decreasing order, are numbered from
+  2^m - 1 down to 0 (m films left), so power[i] is N_{days - 1} of the i-th
+  one after a transform over the m films, and the first film left is bit 0. */
+  uint32_t left = all;
+  for (int days = k; days > 0 and left != 0; --days) {
+    if (stop_requested_now())
+      return false;
+    uint32_t size = uint32_t(1) << __builtin_popcount(left);
+    uint32_t i = size - 1;
+    for (uint32_t s = left;; s = (s - 1) & left, --i) {
+      power[i] = pow_mod(count[s], days - 1);
+      if (s == 0)
+        break;
+    }
+    subset_transform(power, size,
+                     [](uint64_t &a, uint64_t b) { a = sub_mod(a, b); });
+
+    // the day is the films left but the ones of a subset without the first
+    uint32_t first = left & -left, taken = 0;
+    i = size - 1;
+    for (uint32_t s = left;; s = (s - 1) & left, --i) {
+      if ((s & first) == 0 and day[left ^ s] and power[i] != 0) {
+        taken = left ^ s;
+        break;
+      }
+      if (s == 0)
+        break;
+    }
+    if (taken == 0)
+      return false;
+    Day films;
+    for (uint32_t bits = taken; bits != 0; bits &= bits - 1)
+      films.push_back(__builtin_ctz(bits));
+    plan.push_back(films);
+    left ^= taken;
+  }
+  return left == 0;
+}
+
+#endif
@@ -0,0 +1,739 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Exhaustive search: a branch and bound over the day of each film, split in
+tasks among a pool of threads, and the exact engine for the small instances. It
+is run by exh.cc, the daemon, the portfolio and the batch solver, so its state
+lives in a Solver, whose solve() can be called once per instance. */
+
+#ifndef EXH_HH
+#define EXH_HH
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounds.hh"
+#include "construct.hh"
+#include "control.hh"
+#include "exact.hh"
+#include "festival.hh"
+#include "plan.hh"
+#include "preprocess.hh"
+#include "trace.hh"
+#include "writer.hh"
+using namespace std;
+
+namespace exh {
+
+/* A task is a subtree of the search: the day given to each of the first films
+of `order`. */
+using Task = vector<int>;
+
+// A word of the conflicts of a day and the bits a film added to it.
+struct Change {
+  int word;
+  uint64_t bits;
+};
+
+/* State of the search of a thread. projected has a bit for each film already
+planned; the bits past the last film are always set so they are never taken as
+candidates. day_conflicts keeps, for each open day, the films that conflict with
+the ones planned on it: it and the flat plan get a row per day when the day is
+first opened, so they grow with the days of the plans searched rather than with
+the films. changes logs the bits each film added to the conflicts of an open
+day, from changes_start[k] for the film of depth k, so undoing a step clears
+them: a film changes at most as many words as it has conflicts. reachable and
+blocked are scratch sets used to compute the lower bound of a node. */
+struct Search {
+  Flat_plan plan;
+  Task assigned;
+  vector<uint64_t> projected, day_conflicts, reachable, blocked;
+  vector<Change> changes;
+  vector<int> changes_start;
+  long long explored = 0, pruned = 0;
+};
+
+/* Work-stealing pool: each thread takes tasks from the back of its own queue
+and, when it is empty, steals them from the front of the others'. pending counts
+the tasks queued or running, and idle the threads looking for work; while some
+thread is idle, the busy ones give away the shallow branches they have not
+explored yet instead of exploring them. Idle threads sleep until a task is given
+away or the last one ends, so they leave their cores to the busy ones. */
+struct Worker_queue {
+  mutex lock;
+  deque<Task> tasks;
+};
+
+TRACE_COUNTER(trace_nodes, "exh.nodes");
+TRACE_COUNTER(trace_leaves, "exh.leaves");
+TRACE_COUNTER(trace_prune_bound, "exh.prune.bound");
+TRACE_COUNTER(trace_prune_new_day, "exh.prune.new_day");
+TRACE_COUNTER(trace_skip_full, "exh.skip.full_day");
+TRACE_COUNTER(trace_skip_conflict, "exh.skip.conflict");
+TRACE_COUNTER(trace_tasks_given, "exh.tasks.given");
+TRACE_COUNTER(trace_tasks_stolen, "exh.tasks.stolen");
+
+// Tasks are only split while at least this many films are left to assign.
+const int min_split_films = 12;
+
+/* Returns the worst plan matrix of a number of films, that is the one with a
+film per day. */
+inline vector<Day> generate_worst_plan(int films) {
+  vector<Day> worst_plan(films);
+  for (int i = 0; i < films; ++i)
+    worst_plan[i].push_back(i);
+  return worst_plan;
+}
+
+/* Given a set of films, consumes it building a clique greedily: the film with
+most restrictions is added and the set is narrowed to its conflicts until it is
+empty. Returns the films of the clique. */
+inline vector<int> greedy_clique(const Instance &festival, uint64_t *set) {
+  vector<int> clique;
+  while (true) {
+    int best = -1;
+    for (int w = 0; w < festival.words; ++w) {
+      for (uint64_t bits = set[w]; bits != 0; bits &= bits - 1) {
+        int i = w * 64 + __builtin_ctzll(bits);
+        if (best == -1 or
+            festival.num_restrictions[i] > festival.num_restrictions[best])
+          best = i;
+      }
+    }
+    if (best == -1)
+      return clique;
+    clique.push_back(best);
+    intersect_conflicts(festival, best, set);
+  }
+}
+
+/* Adds the conflicts of a film to the conflicts of a day, logging the bits
+that each word gains. */
+inline void add_logged_conflicts(const Instance &festival, int film,
+                                 uint64_t *day, vector<Change> &changes) {
+  if (festival.dense) {
+    const uint64_t *row = festival.conflicts_of(film);
+    for (int w = 0; w < festival.words; ++w)
+      if (uint64_t bits = row[w] & ~day[w]) {
+        changes.push_back({w, bits});
+        day[w] |= bits;
+      }
+    return;
+  }
+  // the neighbours are sorted, so the ones of a word come together
+  size_t start = changes.size();
+  for (int j : festival.neighbours(film)) {
+    int w = j >> 6;
+    uint64_t bit = uint64_t(1) << (j & 63);
+    if (day[w] & bit)
+      continue;
+    if (changes.size() == start or changes.back().word != w)
+      changes.push_back({w, 0});
+    changes.back().bits |= bit;
+    day[w] |= bit;
+  }
+}
+
+// Options of the search, as given on the command line.
+struct Options {
+  int threads = 1;
+  double time_limit = 0;
+  int target_days = 0;
+  /* Instances of up to auto_exact_films films are solved by the exact engine
+  unless --engine asks for one of them. */
+  string engine = "auto";
+  bool preprocess = false;
+  string trace_file;
+};
+
+const char *const usage =
+    "[--threads N] [--time-limit S] [--target-days D]"
+    " [--engine auto|exact|search] [--preprocess] [--trace FILE]";
+
+/* Reads the options of the search from the arguments that follow the input and
+the output. Throws a runtime_error if one is unknown. */
+inline Options parse_options(const vector<string> &args) {
+  Options options;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const string &option = args[i];
+    bool has_value = i + 1 < args.size();
+    if (option == "--threads" and has_value)
+      options.threads = max(1, atoi(args[++i].c_str()));
+    else if (option == "--time-limit" and has_value)
+      options.time_limit = atof(args[++i].c_str());
+    else if (option == "--target-days" and has_value)
+      options.target_days = atoi(args[++i].c_str());
+    else if (option == "--engine" and has_value and
+             (args[i + 1] == "auto" or args[i + 1] == "exact" or
+              args[i + 1] == "search"))
+      options.engine = args[++i];
+    else if (option == "--preprocess")
+      options.preprocess = true;
+    else if (option == "--trace" and has_value)
+      options.trace_file = args[++i];
+    else
+      throw runtime_error("unknown option " + option);
+  }
+  return options;
+}
+
+/* The search and its state. Each call of solve() searches an instance with its
+own bounds, and the threads keep their searches from a call to the next, so
+that the batch solver reuses their memory. */
+class Solver {
+public:
+  // Writes the improved plans to the output file in the background.
+  Writer writer;
+
+  /* Where the search reports its bounds and statistics: the standard error
+  output, unless the caller sends them elsewhere, as the portfolio and the
+  daemon do. */
+  ostream *report = &cerr;
+
+  /* Tells the search of a plan of `days` days found elsewhere, as the portfolio
+  does with the plans of its heuristics, so that it prunes against it and only
+  looks for plans with fewer days. Can be called from any thread, before or
+  while solve() runs. */
+  void offer_bound(int days) {
+    lower_bound_to(offered_days, days);
+    lower_bound_to(min_d, days);
+  }
+
+  /* Searches the plan of the fewest days of an instance, handing the ones that
+  improve to the writer, which must be open, and closes it. The time limit is
+  the caller's to set, and the times of the plans count from `start`. The bounds
+  and the statistics of the search are reported on report. Throws a
+  runtime_error if the exact engine is asked for an instance too large for
+  it. */
+  Outcome solve(const Instance &input, const Options &options, double start) {
+    start_time = start;
+    target_days = options.target_days;
+    preprocess = options.preprocess;
+    // the pool of a previous call may have been stopped with tasks left
+    pending = 0;
+    idle = 0;
+    double solve_start = now();
+
+    lower_bound_to(min_d, input.f);
+    /* min_d keeps the minimum number of days of the best_plan. It is
+    initialized with the worst possible plan, where only a film per day can be
+    projected, unless a better one was offered */
+
+    writer.publish(generate_worst_plan(input.f), input.f, now() - start_time);
+    written_days = input.f;
+    Bounds bounds = lower_bounds(input);
+    best_case = bounds.best();
+    report_bounds(bounds, *report);
+    exact_tried = exact_solved = 0;
+    explored = pruned = 0;
+    // the days the search proved the core needs, if it finishes
+    int core_days;
+    if (not preprocess) {
+      if (min_d <= best_case)
+        request_stop(bound_reached);
+      if (options.engine == "exact" and input.f > max_exact_films)
+        refuse_exact();
+      search(input, bounds.largest_clique, options);
+      core_days = min_d;
+    } else {
+      reduction = reduce_instance(input, best_case);
+      whole = &input;
+      *report << "core: " << reduction.core.size() << " films in "
+              << reduction.components.size() << " components ("
+              << reduction.peeled << " peeled, " << reduction.dominated
+              << " dominated)" << endl;
+      /* Each component is searched apart, from its DSATUR plan, and the plans
+      are merged before the removed films are put back. No plan has fewer days
+      than the bound of any component. */
+      vector<Instance> subs;
+      vector<vector<int>> cliques;
+      vector<int> sub_bound;
+      plans.clear();
+      int largest = 0;
+      for (const vector<int> &films : reduction.components) {
+        subs.push_back(sub_instance(input, films));
+        Bounds sub_bounds = lower_bounds(subs.back());
+        best_case = max(best_case, sub_bounds.best());
+        sub_bound.push_back(sub_bounds.best());
+        cliques.push_back(sub_bounds.largest_clique);
+        vector<int> rank(films.size());
+        for (int i = 0; i < int(films.size()); ++i)
+          rank[i] = i;
+        plans.push_back(dsatur_plan(subs.back(), rank));
+        largest = max<int>(largest, films.size());
+      }
+      *report << "component bound: " << best_case << endl;
+      if (options.engine == "exact" and largest > max_exact_films)
+        refuse_exact();
+      write_plans();
+      if (written_days <= best_case or offered_days <= best_case)
+        request_stop(bound_reached);
+
+      /* The components are searched from the one with the highest bound, and
+      then the most days. A search that finishes proves that the whole instance
+      needs as many days as its plan, so the next ones stop as soon as they have
+      no more: the tightest components usually prove the most at the least
+      cost. */
+      vector<int> sequence(subs.size());
+      for (int k = 0; k < int(subs.size()); ++k)
+        sequence[k] = k;
+      stable_sort(sequence.begin(), sequence.end(), [&](int a, int b) {
+        if (sub_bound[a] != sub_bound[b])
+          return sub_bound[a] > sub_bound[b];
+        return plans[a].size() > plans[b].size();
+      });
+      for (int k : sequence) {
+        if (stop_flagged())
+          break;
+        component = k;
+        min_d = plans[k].size();
+        lower_bound_to(min_d, offered_days);
+        if (min_d <= best_case)
+          continue;
+        search(subs[k], cliques[k], options);
+        if (not stop_flagged())
+          best_case = max<int>(best_case, min_d);
+      }
+      core_days = best_case;
+    }
+    if (exact_tried > 0) {
+      *report << "exact engine: ";
+      if (preprocess)
+        *report << "solved " << exact_solved << " of " << exact_tried
+                << " components" << endl;
+      else
+        *report << (exact_solved > 0 ? "solved" : "gave up") << endl;
+    }
+    TRACE_TIME("solve", now() - solve_start);
+    writer.close();
+    /* The plan is optimal if the search reached the lower bound or explored the
+    whole tree. */
+    if (current_stop_reason() == running)
+      request_stop(finished);
+    /* With --preprocess, the plans of the components only prove the plan
+    written if merging them and putting the films back opened no day. A plan
+    offered by another engine may be better than the ones written, and is
+    proven the same way. */
+    int days = min<int>(written_days, offered_days);
+    Stop_reason reason = current_stop_reason();
+    bool proven = (reason == finished or reason == bound_reached) and
+                  days <= max(core_days, best_case);
+    *report << "stopped: " << stop_description() << endl;
+    *report << "solve time: " << now() - solve_start << " s" << endl;
+    *report << "days: " << days << " (lower bound " << best_case << ", gap "
+            << days - best_case << ", "
+            << (proven ? "optimal" : "not proven optimal") << ")" << endl;
+    *report << "nodes explored: " << explored << ", pruned: " << pruned << endl;
+    forget_bounds();
+    return {days, proven};
+  }
+
+private:
+  int f, l, c, best_case;
+
+  // The search stops as soon as it finds a plan of target_days days (if not 0).
+  int target_days = 0;
+
+  /* min_d keeps the minimum number of days of the best plan found by any of the
+  search threads, which all prune against it. The best plan itself and the
+  output file are only touched holding best_mutex. */
+  atomic<int> min_d{numeric_limits<int>::max()};
+  mutex best_mutex;
+
+  // Days of the best plan found elsewhere and offered to the search, if any.
+  atomic<int> offered_days{numeric_limits<int>::max()};
+
+  // The films are assigned one by one following `order`.
+  vector<int> order;
+
+  // The work-stealing pool, and the search of each of its threads.
+  vector<Worker_queue> queues;
+  atomic<int> pending{0}, idle{0};
+  mutex idle_lock;
+  condition_variable work_ready;
+  vector<Search> searches;
+
+  double start_time;
+
+  /* With --preprocess the search runs on each component of the core of the
+  instance read, whole, in turn, and the plans of the components are put back
+  into plans of whole before they are written. plans keeps the best plan of
+  each component, in films of the component, and `component` is the one being
+  searched. written_days are the days of the last plan written. */
+  bool preprocess = false;
+  const Instance *whole;
+  Reduction reduction;
+  vector<vector<Day>> plans;
+  int component;
+  int written_days;
+
+  // Statistics of the searches of a call.
+  int exact_tried, exact_solved;
+  long long explored, pruned;
+
+  /* Given a matrix containing the best planning, hands it to the writer, which
+  writes it in the output format. */
+  void write(const vector<Day> &plan, int days) {
+    if (preprocess) {
+      plans[component].assign(plan.begin(), plan.begin() + days);
+      write_plans();
+      return;
+    }
+    written_days = days;
+    writer.publish(plan, days, now() - start_time);
+  }
+
+  /* Merges the plans of the components, puts the removed films back and hands
+  the plan to the writer if it has fewer days than the last one written. */
+  void write_plans() {
+    vector<Day> restored =
+        restore_component_plans(*whole, reduction, plans, best_case);
+    if (int(restored.size()) >= written_days)
+      return;
+    written_days = restored.size();
+    writer.publish(move(restored), written_days, now() - start_time);
+  }
+
+  // Closes the writer and throws if the exact engine is asked for too much.
+  void refuse_exact() {
+    writer.close();
+    forget_bounds();
+    throw runtime_error("--engine exact takes at most " +
+                        to_string(max_exact_films) + " films");
+  }
+
+  /* Searches plans of an instance with fewer days than min_d, given a clique of
+  it. The exact engine starts from the bounds of the films it plans: the clique
+  and the capacity. If it is stopped, the search stops at once too; if it gives
+  up, the branch and bound is left to find the plan. */
+  void search(const Instance &festival, const vector<int> &clique,
+              const Options &options) {
+    f = festival.f;
+    l = festival.l;
+    c = festival.c;
+    if (options.engine == "exact" or
+        (options.engine == "auto" and f <= auto_exact_films)) {
+      ++exact_tried;
+      vector<Day> plan;
+      int lower = max<int>(clique.size(), (f + c - 1) / c);
+      if (exact_plan(festival, lower, plan)) {
+        ++exact_solved;
+        lower_bound_to(min_d, plan.size());
+        write(plan, plan.size());
+        if (written_days <= best_case)
+          request_stop(bound_reached);
+        return;
+      }
+    }
+
+    /* The whole tree is the first task; the threads split it as soon as the
+    others are idle. */
+    int threads = options.threads;
+    order = assignment_order(festival, clique);
+    queues = vector<Worker_queue>(threads);
+    queues[0].tasks.push_back(Task());
+    pending = 1;
+    if (int(searches.size()) < threads)
+      searches.resize(threads);
+    for (int i = 0; i < threads; ++i)
+      clear_search(festival, searches[i]);
+    vector<thread> pool;
+    for (int i = 1; i < threads; ++i)
+      pool.push_back(scoped_thread(&Solver::work, this, cref(festival),
+                                   ref(searches[i]), i));
+    work(festival, searches[0], 0);
+    for (thread &t : pool)
+      t.join();
+
+    for (int i = 0; i < threads; ++i) {
+      explored += searches[i].explored;
+      pruned += searches[i].pruned;
+    }
+  }
+
+  /* Returns the order in which the films are assigned: first the films of the
+  clique, which go to different days, and then DSATUR order, that is, each time
+  the film whose planned conflicts are spread over more days, breaking ties by
+  number of restrictions. The order is obtained simulating a first fit plan that
+  respects the c cinemas of each day. */
+  vector<int> assignment_order(const Instance &festival,
+                               const vector<int> &clique) {
+    int words = festival.words;
+    vector<int> sequence, saturation(f, 0), day_size;
+    vector<uint64_t> planned(words, 0), days;
+    for (int k = 0; k < f; ++k) {
+      int film = -1;
+      if (k < int(clique.size()))
+        film = clique[k];
+      else {
+        for (int i = 0; i < f; ++i) {
+          if (test_film(planned.data(), i))
+            continue;
+          if (film == -1 or saturation[i] > saturation[film] or
+              (saturation[i] == saturation[film] and
+               festival.num_restrictions[i] > festival.num_restrictions[film]))
+            film = i;
+        }
+      }
+      sequence.push_back(film);
+      set_film(planned.data(), film);
+
+      int d = 0;
+      while (d < int(day_size.size()) and
+             (day_size[d] == c or test_film(&days[size_t(d) * words], film)))
+        ++d;
+      if (d == int(day_size.size())) {
+        day_size.push_back(0);
+        days.resize(days.size() + words, 0);
+      }
+      ++day_size[d];
+
+      // the unplanned conflicts of the film that had no conflict on day d yet
+      uint64_t *day = &days[size_t(d) * words];
+      for (int i : festival.neighbours(film)) {
+        if (not test_film(day, i) and not test_film(planned.data(), i))
+          ++saturation[i];
+        set_film(day, i);
+      }
+    }
+    return sequence;
+  }
+
+  /* Returns a lower bound of the days of any plan completing the current one,
+  which uses `used` days. The films that fit on no open day (because they are
+  full or in conflict) need new days: at least as many as the size of a clique
+  among them, and as their number divided by c. */
+  int node_bound(const Instance &festival, Search &s, int used) {
+    int words = festival.words;
+    fill(s.reachable.begin(), s.reachable.end(), 0);
+    for (int d = 0; d < used; ++d) {
+      if (int(s.plan[d].size()) < c) {
+        const uint64_t *day = &s.day_conflicts[size_t(d) * words];
+        for (int w = 0; w < words; ++w)
+          s.reachable[w] |= ~day[w];
+      }
+    }
+    int count = 0;
+    for (int w = 0; w < words; ++w) {
+      s.blocked[w] = ~(s.projected[w] | s.reachable[w]);
+      count += __builtin_popcountll(s.blocked[w]);
+    }
+    int bound = used;
+    if (count > 0) {
+      int clique = greedy_clique(festival, s.blocked.data()).size();
+      bound += max(clique, (count + c - 1) / c);
+    }
+    return max(bound, best_case);
+  }
+
+  /* Keeps the current plan of a search as the best one if it still improves it,
+  and writes it. */
+  void improve(const Search &s, int used) {
+    lock_guard<mutex> guard(best_mutex);
+    if (used < min_d) {
+      lower_bound_to(min_d, used);
+      write(s.plan.to_days(used), used);
+      /* the plan written decides: with --preprocess, putting the removed films
+      back may open days */
+      if (written_days <= best_case)
+        request_stop(bound_reached);
+      else if (written_days <= target_days)
+        request_stop(target_reached);
+    }
+  }
+
+  // Plans film order[k] on day d of a search, opening it if d is a new day.
+  void assign(const Instance &festival, Search &s, int k, int d, int used) {
+    int words = festival.words;
+    int film = order[k];
+    if (d == used and s.plan.days() == d) {
+      s.plan.resize(d + 1);
+      s.day_conflicts.resize(size_t(d + 1) * words);
+    }
+    uint64_t *day = &s.day_conflicts[size_t(d) * words];
+    if (d == used)
+      copy_conflicts(festival, film, day);
+    else {
+      s.changes_start[k] = s.changes.size();
+      add_logged_conflicts(festival, film, day, s.changes);
+    }
+    s.plan.push(d, film);
+    s.assigned.push_back(d);
+    set_film(s.projected.data(), film);
+  }
+
+  // Undoes the assignment of film order[k] on day d of a search.
+  void unassign(const Instance &festival, Search &s, int k, int d, int used) {
+    if (d < used) {
+      uint64_t *day = &s.day_conflicts[size_t(d) * festival.words];
+      for (int i = s.changes_start[k]; i < int(s.changes.size()); ++i)
+        day[s.changes[i].word] &= ~s.changes[i].bits;
+      s.changes.resize(s.changes_start[k]);
+    }
+    s.plan.pop(d);
+    s.assigned.pop_back();
+    reset_film(s.projected.data(), order[k]);
+  }
+
+  // Gives away a branch of the search as a new task for an idle thread.
+  void give_away(Search &s, int d, int worker) {
+    TRACE_COUNT(trace_tasks_given);
+    Task task = s.assigned;
+    task.push_back(d);
+    ++pending;
+    {
+      lock_guard<mutex> guard(queues[worker].lock);
+      queues[worker].tasks.push_back(move(task));
+    }
+    wake(false);
+  }
+
+  /* Wakes an idle thread, or all of them. Taking idle_lock first makes sure
+  that no thread is between looking for a task and starting to wait. */
+  void wake(bool all) {
+    { lock_guard<mutex> guard(idle_lock); }
+    if (all)
+      work_ready.notify_all();
+    else
+      work_ready.notify_one();
+  }
+
+  /* Branch and bound that assigns the film order[k] to each open day where it
+  fits, and to a new day only if it would still improve the best plan. As new
+  days are only opened one at a time, plans that just differ on the numbering of
+  their days are explored once. Every time a better plan is found it is written,
+  and the search stops when it reaches the lower bound best_case. */
+  void exhaustive_search_planning(const Instance &festival, Search &s, int k,
+                                  int used, int worker) {
+    if (stop_requested())
+      return;
+    ++s.explored;
+    TRACE_COUNT(trace_nodes);
+    if (k == f) {
+      TRACE_COUNT(trace_leaves);
+      improve(s, used);
+      return;
+    }
+    if (node_bound(festival, s, used) >= min_d) {
+      ++s.pruned;
+      TRACE_COUNT(trace_prune_bound);
+      return;
+    }
+
+    int film = order[k];
+    bool split = f - k >= min_split_films;
+    for (int d = 0; d <= used and not stop_flagged(); ++d) {
+      if (d < used and int(s.plan[d].size()) == c) {
+        TRACE_COUNT(trace_skip_full);
+        continue;
+      }
+      if (d < used and
+          test_film(&s.day_conflicts[size_t(d) * festival.words], film)) {
+        TRACE_COUNT(trace_skip_conflict);
+        continue;
+      }
+      if (d == used and used + 1 >= min_d) {
+        TRACE_COUNT(trace_prune_new_day);
+        break;
+      }
+      if (split and idle > 0)
+        give_away(s, d, worker);
+      else {
+        assign(festival, s, k, d, used);
+        exhaustive_search_planning(festival, s, k + 1, used + (d == used),
+                                   worker);
+        unassign(festival, s, k, d, used);
+      }
+    }
+  }
+
+  // Empties a search, keeping its memory, so that no film is planned yet.
+  void clear_search(const Instance &festival, Search &s) {
+    int words = festival.words;
+    s.plan.assign(0, min(c, f));
+    s.assigned.clear();
+    s.projected.assign(words, 0);
+    for (int i = f; i < words * 64; ++i)
+      set_film(s.projected.data(), i);
+    s.day_conflicts.clear();
+    s.changes.clear();
+    s.changes_start.assign(f, 0);
+    s.reachable.assign(words, 0);
+    s.blocked.assign(words, 0);
+    s.explored = s.pruned = 0;
+  }
+
+  // Forgets the bounds of a call, which only hold for it.
+  void forget_bounds() {
+    min_d = numeric_limits<int>::max();
+    offered_days = numeric_limits<int>::max();
+  }
+
+  /* Takes a task from the back of the queue of a worker or, if it is empty,
+  from the front of another one. Returns false if there was none. */
+  bool take_task(int worker, Task &task) {
+    for (int i = 0; i < int(queues.size()); ++i) {
+      Worker_queue &queue = queues[(worker + i) % queues.size()];
+      lock_guard<mutex> guard(queue.lock);
+      if (not queue.tasks.empty()) {
+        if (i == 0) {
+          task = move(queue.tasks.back());
+          queue.tasks.pop_back();
+        } else {
+          task = move(queue.tasks.front());
+          queue.tasks.pop_front();
+          TRACE_COUNT(trace_tasks_stolen);
+        }
+        return true;
+      }
+    }
+    return false;
+  }
+
+  /* Loop of a search thread: replays the assignments of each task it takes and
+  explores its subtree, until no task is left in any queue nor running, or the
+  search has to stop. */
+  void work(const Instance &festival, Search &s, int worker) {
+    Task task;
+    while (pending > 0 and not stop_requested()) {
+      if (not take_task(worker, task)) {
+        /* a stop does not wake the idle threads, so they look at the clock
+        now and then */
+        ++idle;
+        bool found = false;
+        unique_lock<mutex> guard(idle_lock);
+        while (pending > 0 and not stop_requested() and
+               not (found = take_task(worker, task)))
+          work_ready.wait_for(guard, chrono::milliseconds(10));
+        guard.unlock();
+        --idle;
+        if (not found)
+          break;
+      }
+      vector<int> used(task.size() + 1, 0);
+      for (int k = 0; k < int(task.size()); ++k) {
+        assign(festival, s, k, task[k], used[k]);
+        used[k + 1] = used[k] + (task[k] == used[k]);
+      }
+      exhaustive_search_planning(festival, s, task.size(), used.back(), worker);
+      for (int k = task.size() - 1; k >= 0; --k)
+        unassign(festival, s, k, task[k], used[k]);
+      if (--pending == 0)
+        wake(true);
+    }
+  }
+};
+
+} // namespace exh
+
+#endif
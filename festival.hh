@@ -0,0 +1,534 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Shared instance reader for the three solvers. The input is read through a
+memory-mapped view of the file, titles are interned into a hash index so each
+restriction is resolved in O(1), and the restrictions are stored as sorted
+lists of conflicts, plus a packed bit matrix when the instance is dense enough
+for it to pay off. Instances compiled to the binary format (see compile.cc) are
+recognised by their magic number and loaded without parsing. */
+
+#ifndef FESTIVAL_HH
+#define FESTIVAL_HH
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+/* The films planned on a day, in the order of the cinemas: the film at position
+k is screened in cinema k. The solvers fill the cinemas in order; a repaired
+plan may leave one free with -1, so that the films after it keep theirs. */
+using Day = vector<int>;
+
+// Returns true if a film is marked on a set of films.
+inline bool test_film(const uint64_t *mask, int film) {
+  return mask[film >> 6] >> (film & 63) & 1;
+}
+
+// Marks a film on a set of films.
+inline void set_film(uint64_t *mask, int film) {
+  mask[film >> 6] |= uint64_t(1) << (film & 63);
+}
+
+// Removes a film from a set of films.
+inline void reset_film(uint64_t *mask, int film) {
+  mask[film >> 6] &= ~(uint64_t(1) << (film & 63));
+}
+
+// Range of the films in conflict with a film, as stored in an instance.
+struct Neighbours {
+  const int *first, *last;
+  const int *begin() const { return first; }
+  const int *end() const { return last; }
+};
+
+/* An instance of the festival. The films in conflict with film i are
+adjacency[adjacency_start[i]] to adjacency[adjacency_start[i + 1] - 1], in
+increasing order. If the instance is dense, the restrictions are also kept in a
+bit matrix: bit j of row i is set if films i and j cannot be projected on the
+same day. Every row, and every other set of films, takes `words` 64-bit
+words. */
+struct Instance {
+  int f = 0, l = 0, c = 0;
+  vector<string> titles;
+  vector<string> cinemas;
+  vector<int> num_restrictions;
+  vector<int> adjacency_start, adjacency;
+  bool dense = false;
+  int words = 0;
+  vector<uint64_t> conflicts;
+
+  // Returns a pointer to the conflicts row of a film (only if dense).
+  const uint64_t *conflicts_of(int film) const {
+    return &conflicts[size_t(film) * words];
+  }
+
+  // Returns the films in conflict with a film.
+  Neighbours neighbours(int film) const {
+    return {adjacency.data() + adjacency_start[film],
+            adjacency.data() + adjacency_start[film + 1]};
+  }
+
+  // Returns true if two films cannot be projected on the same day.
+  bool restricted(int a, int b) const {
+    if (dense)
+      return test_film(conflicts_of(a), b);
+    Neighbours n = neighbours(a);
+    return binary_search(n.begin(), n.end(), b);
+  }
+};
+
+/* The bit matrix is kept if it takes at most dense_bytes, or at most
+dense_ratio times the memory of the lists of conflicts. Otherwise it would be
+mostly zeros: at a million films it would take 125 GB. */
+const size_t dense_bytes = size_t(64) << 20;
+const int dense_ratio = 8;
+
+/* Decides the layout of an instance with its lists of conflicts built, and
+builds the bit matrix if it is dense. */
+inline void choose_layout(Instance &inst) {
+  inst.words = (inst.f + 63) / 64;
+  size_t matrix = size_t(inst.f) * inst.words * sizeof(uint64_t);
+  size_t lists =
+      (inst.adjacency_start.size() + inst.adjacency.size()) * sizeof(int);
+  inst.dense = matrix <= dense_bytes or matrix <= dense_ratio * lists;
+  inst.conflicts.clear();
+  if (not inst.dense)
+    return;
+  inst.conflicts.assign(size_t(inst.f) * inst.words, 0);
+  for (int i = 0; i < inst.f; ++i) {
+    uint64_t *row = &inst.conflicts[size_t(i) * inst.words];
+    for (int j : inst.neighbours(i))
+      set_film(row, j);
+  }
+}
+
+/* Builds the lists of conflicts of an instance from its restricted pairs, which
+can be repeated, and chooses its layout. */
+inline void build_conflicts(Instance &inst,
+                            const vector<pair<int, int>> &pairs) {
+  vector<int> &start = inst.adjacency_start;
+  start.assign(inst.f + 1, 0);
+  for (const auto &[a, b] : pairs) {
+    ++start[a + 1];
+    ++start[b + 1];
+  }
+  for (int i = 0; i < inst.f; ++i)
+    start[i + 1] += start[i];
+  vector<int> &adjacency = inst.adjacency;
+  adjacency.resize(start[inst.f]);
+  vector<int> next(start.begin(), start.end() - 1);
+  for (const auto &[a, b] : pairs) {
+    adjacency[next[a]++] = b;
+    adjacency[next[b]++] = a;
+  }
+
+  // each list is sorted and its repetitions removed, compacting the lists
+  inst.num_restrictions.assign(inst.f, 0);
+  int size = 0;
+  for (int i = 0; i < inst.f; ++i) {
+    int *begin = &adjacency[0] + start[i], *end = &adjacency[0] + start[i + 1];
+    sort(begin, end);
+    end = unique(begin, end);
+    start[i] = size;
+    size = copy(begin, end, adjacency.begin() + size) - adjacency.begin();
+    inst.num_restrictions[i] = size - start[i];
+  }
+  start[inst.f] = size;
+  adjacency.resize(size);
+  adjacency.shrink_to_fit();
+  choose_layout(inst);
+}
+
+// Adds the films in conflict with a film to a set of films.
+inline void add_conflicts(const Instance &inst, int film, uint64_t *set) {
+  if (inst.dense) {
+    const uint64_t *row = inst.conflicts_of(film);
+    for (int w = 0; w < inst.words; ++w)
+      set[w] |= row[w];
+  } else {
+    for (int j : inst.neighbours(film))
+      set_film(set, j);
+  }
+}
+
+// Makes a set of films hold the films in conflict with a film.
+inline void copy_conflicts(const Instance &inst, int film, uint64_t *set) {
+  if (inst.dense) {
+    const uint64_t *row = inst.conflicts_of(film);
+    copy(row, row + inst.words, set);
+  } else {
+    fill(set, set + inst.words, 0);
+    add_conflicts(inst, film, set);
+  }
+}
+
+// Narrows a set of films to the ones in conflict with a film.
+inline void intersect_conflicts(const Instance &inst, int film, uint64_t *set) {
+  if (inst.dense) {
+    const uint64_t *row = inst.conflicts_of(film);
+    for (int w = 0; w < inst.words; ++w)
+      set[w] &= row[w];
+    return;
+  }
+  thread_local vector<int> kept;
+  kept.clear();
+  for (int j : inst.neighbours(film))
+    if (test_film(set, j))
+      kept.push_back(j);
+  fill(set, set + inst.words, 0);
+  for (int i : kept)
+    set_film(set, i);
+}
+
+/* Empties a set of films that only holds films in conflict with some films.
+Without the bit matrix, only the bits of their conflicts are cleared. */
+inline void clear_conflicts(const Instance &inst, const vector<int> &films,
+                            uint64_t *set) {
+  if (inst.dense) {
+    fill(set, set + inst.words, 0);
+    return;
+  }
+  for (int film : films)
+    for (int j : inst.neighbours(film))
+      reset_film(set, j);
+}
+
+/* Read-only view of a whole file. It is memory-mapped when possible and read
+into a buffer otherwise (pipes, special files). */
+class File_view {
+public:
+  explicit File_view(const string &path) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0)
+      throw runtime_error(path + ": cannot open file");
+    struct stat st;
+    if (fstat(fd, &st) == 0 and S_ISREG(st.st_mode) and st.st_size > 0) {
+      void *p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+      if (p != MAP_FAILED) {
+        madvise(p, st.st_size, MADV_SEQUENTIAL);
+        map = static_cast<const char *>(p);
+        len = st.st_size;
+      }
+    }
+    if (map == nullptr) {
+      char chunk[1 << 16];
+      ssize_t n;
+      while ((n = read(fd, chunk, sizeof chunk)) > 0)
+        buffer.append(chunk, n);
+    }
+    close(fd);
+  }
+  ~File_view() {
+    if (map != nullptr)
+      munmap(const_cast<char *>(map), len);
+  }
+  File_view(const File_view &) = delete;
+  File_view &operator=(const File_view &) = delete;
+
+  string_view data() const {
+    if (map != nullptr)
+      return string_view(map, len);
+    return buffer;
+  }
+
+private:
+  const char *map = nullptr;
+  size_t len = 0;
+  string buffer;
+};
+
+/* Splits the input into whitespace-separated tokens, keeping track of the line
+number for the error messages. */
+class Tokenizer {
+public:
+  Tokenizer(string_view text, const string &name) : text(text), name(name) {}
+
+  string_view next(const char *what) {
+    if (done())
+      fail(string("unexpected end of file, expected ") + what);
+    size_t begin = pos;
+    while (pos < text.size() and not is_space(text[pos]))
+      ++pos;
+    return text.substr(begin, pos - begin);
+  }
+
+  int next_int(const char *what, int min) {
+    string_view token = next(what);
+    long long value = 0;
+    for (char ch : token) {
+      if (ch < '0' or ch > '9' or value > INT32_MAX)
+        fail(string("expected ") + what + ", found '" + string(token) + "'");
+      value = 10 * value + (ch - '0');
+    }
+    if (value < min or value > INT32_MAX)
+      fail(string(what) + " out of range: " + string(token));
+    return value;
+  }
+
+  // Skips the white space and returns true if nothing else is left.
+  bool done() {
+    while (pos < text.size() and is_space(text[pos])) {
+      if (text[pos] == '\n')
+        ++line;
+      ++pos;
+    }
+    return pos == text.size();
+  }
+
+  [[noreturn]] void fail(const string &message) const {
+    throw runtime_error(name + ":" + to_string(line) + ": " + message);
+  }
+
+private:
+  static bool is_space(char ch) {
+    return ch == ' ' or ch == '\n' or ch == '\t' or ch == '\r' or ch == '\f' or
+           ch == '\v';
+  }
+
+  string_view text;
+  const string &name;
+  size_t pos = 0;
+  int line = 1;
+};
+
+/* Header of the compiled instance format. It is followed by these arrays, each
+one starting at a multiple of 8 bytes from the start of the file:
+  title_start[f + 1]      (uint64) offsets of each title in the title bytes
+  the title bytes         (title_bytes chars)
+  cinema_start[c + 1]     (uint64) offsets of each name in the cinema bytes
+  the cinema bytes        (cinema_bytes chars)
+  adjacency_start[f + 1]  (uint64) offsets of the neighbours of each film
+  adjacency[2 * pairs]    (uint32) films restricted with each film
+Numbers are in the byte order of the machine; a file compiled on a machine with
+another order is rejected because its magic number does not match. */
+struct Binary_header {
+  uint64_t magic;
+  uint32_t version;
+  uint32_t f, c;
+  uint32_t unused;
+  uint64_t pairs;
+  uint64_t title_bytes, cinema_bytes;
+};
+
+// "FESTIVAL" read as a native number, and the version of the format.
+const uint64_t binary_magic = 0x4c41564954534546;
+const uint32_t binary_version = 1;
+
+// Returns true if some data is a compiled instance.
+inline bool is_binary_instance(string_view data) {
+  uint64_t magic;
+  if (data.size() < sizeof magic)
+    return false;
+  memcpy(&magic, data.data(), sizeof magic);
+  return magic == binary_magic;
+}
+
+/* Returns a pointer to the next array of n values of a compiled instance,
+moving the offset past it and its padding. */
+template <class T>
+const T *binary_array(string_view data, size_t &offset, uint64_t n,
+                      const string &path) {
+  if (n > (data.size() - offset) / sizeof(T))
+    throw runtime_error(path + ": truncated binary instance");
+  const T *array = reinterpret_cast<const T *>(data.data() + offset);
+  offset += (n * sizeof(T) + 7) / 8 * 8;
+  offset = min(offset, data.size());
+  return array;
+}
+
+/* Reads the names of a compiled instance given their offsets, checking that
+they fit in their bytes. */
+inline vector<string> binary_names(const uint64_t *start, int n,
+                                   const char *bytes, uint64_t size,
+                                   const string &path) {
+  vector<string> names(n);
+  for (int i = 0; i < n; ++i) {
+    if (start[i] > start[i + 1] or start[i + 1] > size)
+      throw runtime_error(path + ": corrupt binary instance");
+    names[i].assign(bytes + start[i], start[i + 1] - start[i]);
+  }
+  return names;
+}
+
+/* Loads a compiled instance from its data: the names are copied and the
+restrictions are set from the adjacency arrays, with no parsing. Throws a
+runtime_error if the file has another version or is inconsistent. */
+inline Instance read_binary_instance(string_view data, const string &path) {
+  Binary_header header;
+  if (data.size() < sizeof header)
+    throw runtime_error(path + ": truncated binary instance");
+  memcpy(&header, data.data(), sizeof header);
+  if (header.version != binary_version)
+    throw runtime_error(path + ": unsupported binary instance version " +
+                        to_string(header.version));
+  if (header.f < 1 or header.c < 1 or
+      header.f > uint32_t(numeric_limits<int>::max()) or
+      header.c > uint32_t(numeric_limits<int>::max()))
+    throw runtime_error(path + ": corrupt binary instance");
+
+  Instance inst;
+  inst.f = header.f;
+  inst.c = header.c;
+  size_t offset = sizeof header;
+  const uint64_t *title_start =
+      binary_array<uint64_t>(data, offset, uint64_t(inst.f) + 1, path);
+  const char *titles =
+      binary_array<char>(data, offset, header.title_bytes, path);
+  const uint64_t *cinema_start =
+      binary_array<uint64_t>(data, offset, uint64_t(inst.c) + 1, path);
+  const char *cinemas =
+      binary_array<char>(data, offset, header.cinema_bytes, path);
+  const uint64_t *adjacency_start =
+      binary_array<uint64_t>(data, offset, uint64_t(inst.f) + 1, path);
+  const uint32_t *adjacency =
+      binary_array<uint32_t>(data, offset, 2 * header.pairs, path);
+
+  inst.titles =
+      binary_names(title_start, inst.f, titles, header.title_bytes, path);
+  inst.cinemas =
+      binary_names(cinema_start, inst.c, cinemas, header.cinema_bytes, path);
+
+  if (2 * header.pairs > uint64_t(numeric_limits<int>::max()) or
+      adjacency_start[0] != 0 or adjacency_start[inst.f] != 2 * header.pairs)
+    throw runtime_error(path + ": corrupt binary instance");
+  inst.l = header.pairs;
+  inst.adjacency_start.assign(adjacency_start, adjacency_start + inst.f + 1);
+  inst.adjacency.assign(adjacency, adjacency + 2 * header.pairs);
+  inst.num_restrictions.assign(inst.f, 0);
+  for (int i = 0; i < inst.f; ++i) {
+    if (adjacency_start[i] > adjacency_start[i + 1] or
+        adjacency_start[i + 1] > 2 * header.pairs)
+      throw runtime_error(path + ": corrupt binary instance");
+    // the lists must be increasing, without the film itself
+    int previous = -1;
+    for (int j : inst.neighbours(i)) {
+      if (j <= previous or j >= inst.f or j == i)
+        throw runtime_error(path + ": corrupt binary instance");
+      previous = j;
+    }
+    inst.num_restrictions[i] = adjacency_start[i + 1] - adjacency_start[i];
+  }
+  choose_layout(inst);
+  // every restriction has to be listed by both films
+  for (int i = 0; i < inst.f; ++i)
+    for (int j : inst.neighbours(i))
+      if (not inst.restricted(j, i))
+        throw runtime_error(path + ": corrupt binary instance");
+  return inst;
+}
+
+// Appends the bytes of some values to a buffer, padding it to 8 bytes.
+template <class T>
+void binary_append(string &buffer, const T *values, size_t n) {
+  buffer.append(reinterpret_cast<const char *>(values), n * sizeof(T));
+  buffer.append((8 - buffer.size() % 8) % 8, '\0');
+}
+
+// Appends a table of names: their offsets and then their bytes.
+inline void binary_append_names(string &buffer, const vector<string> &names) {
+  vector<uint64_t> start(1, 0);
+  string bytes;
+  for (const string &name : names) {
+    bytes += name;
+    start.push_back(bytes.size());
+  }
+  binary_append(buffer, start.data(), start.size());
+  binary_append(buffer, bytes.data(), bytes.size());
+}
+
+// Returns an instance in the compiled format, as read by read_binary_instance.
+inline string binary_instance(const Instance &festival) {
+  vector<uint64_t> adjacency_start(festival.adjacency_start.begin(),
+                                   festival.adjacency_start.end());
+  vector<uint32_t> adjacency(festival.adjacency.begin(),
+                             festival.adjacency.end());
+
+  Binary_header header = {};
+  header.magic = binary_magic;
+  header.version = binary_version;
+  header.f = festival.f;
+  header.c = festival.c;
+  header.pairs = adjacency.size() / 2;
+  for (const string &title : festival.titles)
+    header.title_bytes += title.size();
+  for (const string &cinema : festival.cinemas)
+    header.cinema_bytes += cinema.size();
+
+  string buffer;
+  binary_append(buffer, &header, 1);
+  binary_append_names(buffer, festival.titles);
+  binary_append_names(buffer, festival.cinemas);
+  binary_append(buffer, adjacency_start.data(), adjacency_start.size());
+  binary_append(buffer, adjacency.data(), adjacency.size());
+  return buffer;
+}
+
+/* Parses an instance in the festival text format in a single pass, or a
+compiled one, from data named `name` in the error messages. Throws a
+runtime_error naming it and the line if the input is malformed or a restriction
+refers to an unknown film. */
+inline Instance parse_instance(string_view data, const string &name) {
+  if (is_binary_instance(data))
+    return read_binary_instance(data, name);
+  Tokenizer in(data, name);
+  Instance inst;
+
+  inst.f = in.next_int("number of films", 1);
+  inst.titles.resize(inst.f);
+  unordered_map<string_view, int> index;
+  index.reserve(inst.f);
+  for (int i = 0; i < inst.f; ++i) {
+    string_view title = in.next("film title");
+    if (not index.emplace(title, i).second)
+      in.fail("repeated film title '" + string(title) + "'");
+    inst.titles[i] = string(title);
+  }
+
+  inst.l = in.next_int("number of restrictions", 0);
+  // each restriction is listed by both films
+  if (inst.l > numeric_limits<int>::max() / 2)
+    in.fail("too many restrictions");
+  vector<pair<int, int>> pairs(inst.l);
+  for (int i = 0; i < inst.l; ++i) {
+    int film[2];
+    for (int &k : film) {
+      string_view title = in.next("film title");
+      auto it = index.find(title);
+      if (it == index.end())
+        in.fail("unknown film title '" + string(title) + "' in restriction");
+      k = it->second;
+    }
+    if (film[0] == film[1])
+      in.fail("film '" + inst.titles[film[0]] + "' restricted with itself");
+    pairs[i] = {film[0], film[1]};
+  }
+  // repeated pairs are accepted but only counted once
+  build_conflicts(inst, pairs);
+
+  inst.c = in.next_int("number of cinemas", 1);
+  inst.cinemas.resize(inst.c);
+  for (int i = 0; i < inst.c; ++i)
+    inst.cinemas[i] = string(in.next("cinema name"));
+  return inst;
+}
+
+// Reads an instance from a file, as parse_instance.
+inline Instance read_instance(const string &path) {
+  File_view file(path);
+  return parse_instance(file.data(), path);
+}
+
+#endif
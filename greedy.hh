@@ -0,0 +1,249 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Greedy planner: a single plan built by the next fit order, DSATUR or RLF,
+optionally on the core left by the reduction. It is run by greedy.cc and by the
+daemon, so its state lives in a Solver, whose solve() can be called once per
+instance. */
+
+#ifndef GREEDY_HH
+#define GREEDY_HH
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounds.hh"
+#include "construct.hh"
+#include "control.hh"
+#include "festival.hh"
+#include "preprocess.hh"
+#include "trace.hh"
+#include "writer.hh"
+using namespace std;
+
+namespace greedy {
+
+/* For each film, we will need to know its numeric identifier (index) and its
+number of restrictions. */
+struct Film_info {
+  int idx;
+  int num_restrictions = 0;
+};
+
+/* If two films have different number of restrictions, returns the most
+restricted. Otherwise, returns the one with the lowest index. */
+inline bool film_sorter(Film_info const &f1, Film_info const &f2) {
+  if (f1.num_restrictions != f2.num_restrictions)
+    return f1.num_restrictions > f2.num_restrictions;
+  return f1.idx < f2.idx;
+}
+
+/* Boolean function that returns true if we have any restriction between the
+current film and the ones already planned on a day, given the films in conflict
+with that day. */
+inline bool restricted(const Film_info &current_film,
+                       const vector<uint64_t> &day_conflicts) {
+  return test_film(day_conflicts.data(), current_film.idx);
+}
+
+/* Plans a film on a day and adds the films in conflict with it to the ones in
+conflict with the day. */
+inline void plan_film(const Instance &festival, const Film_info &film,
+                      Day &day_plan, vector<uint64_t> &day_conflicts) {
+  day_plan.push_back(film.idx);
+  add_conflicts(festival, film.idx, day_conflicts.data());
+}
+
+/* Builds a plan on the core of an instance left by the reduction: the
+components are planned by a pool of threads, merged and the removed films put
+back. The size of the core is reported on `report`. */
+inline vector<Day> preprocessed_plan(const Instance &festival,
+                                     Construction construction,
+                                     int lower_bound, ostream &report) {
+  Reduction r = reduce_instance(festival, lower_bound);
+  report << "core: " << r.core.size() << " films in " << r.components.size()
+         << " components (" << r.peeled << " peeled, " << r.dominated
+         << " dominated)" << endl;
+
+  vector<vector<Day>> plans(r.components.size());
+  atomic<int> next{0};
+  auto work = [&]() {
+    for (int k = next++; k < int(plans.size()); k = next++) {
+      Instance sub = sub_instance(festival, r.components[k]);
+      vector<int> rank(sub.f);
+      for (int i = 0; i < sub.f; ++i)
+        rank[i] = i;
+      plans[k] = construction == dsatur ? dsatur_plan(sub, rank)
+                                        : rlf_plan(sub, rank);
+    }
+  };
+  vector<thread> pool;
+  for (int i = 1; i < int(thread::hardware_concurrency()); ++i)
+    pool.emplace_back(work);
+  work();
+  for (thread &t : pool)
+    t.join();
+  return restore_component_plans(festival, r, move(plans), lower_bound);
+}
+
+// Options of the planner, as given on the command line.
+struct Options {
+  Construction construction = dsatur;
+  bool preprocess = false;
+  /* Taken as by the other solvers, so that they are all run the same way. The
+  plan is built in one go, so the time limit and the target days can only spare
+  the bounds, which are computed after it. */
+  double time_limit = 0;
+  int target_days = 0;
+  string trace_file;
+};
+
+const char *const usage =
+    "[--construct next-fit|dsatur|rlf] [--preprocess] [--time-limit S]"
+    " [--target-days D] [--trace FILE]";
+
+/* Reads the options of the planner from the arguments that follow the input
+and the output. Throws a runtime_error if one is unknown or they do not go
+together. */
+inline Options parse_options(const vector<string> &args) {
+  Options options;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const string &option = args[i];
+    bool has_value = i + 1 < args.size();
+    if (option == "--construct" and has_value and
+        parse_construction(args[i + 1], options.construction))
+      ++i;
+    else if (option == "--preprocess")
+      options.preprocess = true;
+    else if (option == "--time-limit" and has_value)
+      options.time_limit = atof(args[++i].c_str());
+    else if (option == "--target-days" and has_value)
+      options.target_days = atoi(args[++i].c_str());
+    else if (option == "--trace" and has_value)
+      options.trace_file = args[++i];
+    else
+      throw runtime_error("unknown option " + option);
+  }
+  if (options.preprocess and options.construction == next_fit)
+    throw runtime_error("--preprocess needs the dsatur or rlf construction");
+  return options;
+}
+
+// The planner and its state, for one plan per call of solve().
+class Solver {
+public:
+  // Writes the plan to the output file.
+  Writer writer;
+
+  /* Where the planner reports its times and bounds: the standard error output,
+  unless the caller sends them elsewhere, as the daemon does. */
+  ostream *report = &cerr;
+
+  /* Plans an instance, handing the plan to the writer, which must be open, and
+  closes it. The time limit is the caller's to set, and the times of the plans
+  count from `start`. The times and the bounds are reported on report, unless
+  the planner is stopped or reaches the target days before the bounds are
+  computed. */
+  Outcome solve(const Instance &festival, const Options &options,
+                double start) {
+    start_time = start;
+    f = festival.f;
+    l = festival.l;
+    c = festival.c;
+    double solve_start = now();
+    int days;
+    Bounds bounds;
+    if (options.preprocess) {
+      bounds = lower_bounds(festival);
+      vector<Day> plan =
+          preprocessed_plan(festival, options.construction, bounds.best(),
+                            *report);
+      write(plan, plan.size() - 1);
+      days = plan.size();
+    } else if (options.construction == next_fit) {
+      vector<Film_info> films_info(f);
+      for (int i = 0; i < f; ++i) {
+        films_info[i].idx = i;
+        films_info[i].num_restrictions = festival.num_restrictions[i];
+      }
+
+      // Sorts the film_info by number of restrictions in descending order;
+      sort(films_info.begin(), films_info.end(), film_sorter);
+
+      int d = 0;
+      vector<Day> plan(f);
+      greedy_planning(festival, films_info, plan, d);
+      days = d + 1;
+    } else {
+      // ties are broken by index, as in the next fit order
+      vector<int> rank(f);
+      for (int i = 0; i < f; ++i)
+        rank[i] = i;
+      vector<Day> plan = options.construction == dsatur
+                             ? dsatur_plan(festival, rank)
+                             : rlf_plan(festival, rank);
+      write(plan, plan.size() - 1);
+      days = plan.size();
+    }
+    TRACE_TIME("solve", now() - solve_start);
+    writer.close();
+    *report << "solve time: " << now() - solve_start << " s" << endl;
+    if (options.target_days > 0 and days <= options.target_days)
+      request_stop(target_reached);
+    bool stopped = stop_requested_now();
+    *report << "stopped: " << stop_description() << endl;
+
+    // the bounds are only reported, so they are computed after the plan is out
+    if (not options.preprocess) {
+      if (stopped)
+        return {days, false};
+      bounds = lower_bounds(festival);
+    }
+    report_bounds(bounds, *report);
+    report_gap(bounds.best(), days, *report);
+    return {days, days <= bounds.best()};
+  }
+
+private:
+  int f, l, c;
+  double start_time;
+
+  /* Given a matrix containing the plan of d + 1 days, hands it to the writer,
+  which writes it in the output format. */
+  void write(const vector<Day> &plan, int d) {
+    writer.publish(vector<Day>(plan.begin(), plan.begin() + d + 1), d + 1,
+                   now() - start_time);
+  }
+
+  // Generates a plan of d days without restrictions using a greedy algorithm.
+  void greedy_planning(const Instance &festival, vector<Film_info> &films_info,
+                       vector<Day> &plan, int &d) {
+    /* Only the last day can receive films, so we just keep the films in
+    conflict with it. */
+    vector<uint64_t> day_conflicts(festival.words, 0);
+
+    // The most restricted film index is put on the first day of the plan;
+    plan_film(festival, films_info[0], plan[0], day_conflicts);
+
+    for (int i = 1; i < f; ++i) {
+      /* For all films, the following most restricted film index is picked,
+      which is placed in the plan, checking if it is possible to do it on the
+      same day or if we will need to go to the next one. */
+      if (int(plan[d].size()) == c or
+          restricted(films_info[i], day_conflicts)) {
+        clear_conflicts(festival, plan[d], day_conflicts.data());
+        d += 1;
+      }
+      plan_film(festival, films_info[i], plan[d], day_conflicts);
+    }
+    write(plan, d);
+  }
+};
+
+} // namespace greedy
+
+#endif
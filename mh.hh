@@ -0,0 +1,1408 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Metaheuristic search: simulated annealing from random greedy plans (in
+independent restarts or in a ladder of parallel tempering) or a tabu search
+on a fixed number of days, on as many threads as asked. It is run by mh.cc, the
+daemon, the portfolio and the batch solver, so its state lives in a Solver,
+whose solve() can be called once per instance. */
+
+#ifndef MH_HH
+#define MH_HH
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <condition_variable>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <random>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounds.hh"
+#include "construct.hh"
+#include "control.hh"
+#include "festival.hh"
+#include "plan.hh"
+#include "preprocess.hh"
+#include "trace.hh"
+#include "writer.hh"
+using namespace std;
+
+namespace mh {
+
+// We will use this structure to order the films considering their restrictions.
+struct Film_info {
+  int idx;
+};
+
+/* We will use this structure to store the solutions and their info. Days are
+slots that may be empty: plan has the films of each slot (in a flat plan, so
+moves never allocate), day_of and position locate each film in it, open_days
+lists the slots with films (open_index locates them in it), free_days the ones
+with films and some cinema left (free_index locates them in it) and empty_days
+the ones without films. conflicts[film * slots + d] counts the restrictions of
+the film with the films planned on slot d, so the cost of moving a film is
+known without looking at the plan. The cost is the days plus the restrictions
+weighted by penalty. */
+struct Solution {
+  Flat_plan plan;
+  vector<int> day_of, position;
+  vector<int> open_days, open_index, free_days, free_index, empty_days;
+  vector<int> conflicts;
+  int slots;
+  int cost;
+  int days;
+  int restrictions;
+  int penalty;
+};
+
+/* Random number generator (xoshiro256**, seeded with splitmix64). Each solver
+owns one, so the same seed always gives the same run. It can be passed to the
+standard algorithms as a uniform random bit generator. */
+struct Random {
+  using result_type = uint64_t;
+  uint64_t state[4];
+
+  explicit Random(uint64_t seed) {
+    for (uint64_t &s : state) {
+      seed += 0x9e3779b97f4a7c15;
+      uint64_t z = seed;
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+      s = z ^ (z >> 31);
+    }
+  }
+
+  static constexpr uint64_t min() { return 0; }
+  static constexpr uint64_t max() { return UINT64_MAX; }
+
+  uint64_t operator()() {
+    uint64_t result = rotl(state[1] * 5, 7) * 9;
+    uint64_t t = state[1] << 17;
+    state[2] ^= state[0];
+    state[3] ^= state[1];
+    state[1] ^= state[2];
+    state[0] ^= state[3];
+    state[2] ^= t;
+    state[3] = rotl(state[3], 45);
+    return result;
+  }
+
+  // Returns a random integer between 0 and n - 1.
+  int below(int n) { return (unsigned __int128)(*this)() * n >> 64; }
+
+  // Returns a random number beetween 0 and 1.
+  double real() { return ((*this)() >> 11) * 0x1.0p-53; }
+
+private:
+  static uint64_t rotl(uint64_t x, int k) { return (x << k) | (x >> (64 - k)); }
+};
+
+// We will use this structure to keep the best plan found.
+struct Best {
+  vector<Day> plan;
+  int days;
+};
+
+/* How the temperature of an annealing run falls. plain, the default, starts
+at plain_start and multiplies it by plain_ratio after every move. The others
+start at a temperature T0 calibrated on the first solution and take it to T0 *
+final_ratio over schedule_moves moves: geometric multiplies it by a constant,
+Lundy-Mees divides it by 1 + beta T (slowly while hot, fast once cold), and
+adaptive raises or lowers it after every window of moves so that the share of
+accepted moves follows a target falling from initial_acceptance to
+final_acceptance. */
+enum Cooling { plain, geometric, lundy_mees, adaptive };
+
+/* Boolean function that checks if a film can be planned on an specific day,
+given the films in conflict with the ones already planned on that day. */
+inline bool restricted(const vector<uint64_t> &day_conflicts,
+                       const Film_info &f_i) {
+  return test_film(day_conflicts.data(), f_i.idx);
+}
+
+/* Plans a film on a day and adds the films in conflict with it to the ones in
+conflict with the day. */
+inline void plan_film(const Instance &festival, const Film_info &f_i,
+                      Day &day_plan, vector<uint64_t> &day_conflicts) {
+  day_plan.push_back(f_i.idx);
+  add_conflicts(festival, f_i.idx, day_conflicts.data());
+}
+
+// Returns the position of the counter of restrictions of a film with a day.
+inline int &day_restrictions(Solution &s, int film, int day) {
+  return s.conflicts[size_t(film) * s.slots + day];
+}
+
+inline int day_restrictions(const Solution &s, int film, int day) {
+  return s.conflicts[size_t(film) * s.slots + day];
+}
+
+// Adds a day to a list of days, keeping its position in the index.
+inline void add_day(vector<int> &days, vector<int> &index, int day) {
+  index[day] = days.size();
+  days.push_back(day);
+}
+
+// Removes a day from a list of days, moving the last one to its position.
+inline void erase_day(vector<int> &days, vector<int> &index, int day) {
+  int moved = days.back();
+  days[index[day]] = moved;
+  index[moved] = index[day];
+  days.pop_back();
+}
+
+/* Returns the best plan kept by a solution, only with the days that have films
+so that they are numbered consecutively. */
+inline Best snapshot(const Solution &s) {
+  Best best;
+  best.days = s.days;
+  for (int day : s.open_days)
+    best.plan.emplace_back(s.plan[day].begin(), s.plan[day].end());
+  return best;
+}
+
+/* Returns the difference of cost of moving a film to another day (or to a new
+one, if new_day is -1), using only the counters of its restrictions. */
+inline int move_cost(const Solution &current, int film, int new_day) {
+  int old_day = current.day_of[film];
+  int restrictions = -day_restrictions(current, film, old_day);
+  int days = current.plan[old_day].size() == 1 ? -1 : 0;
+  if (new_day == -1)
+    ++days;
+  else
+    restrictions += day_restrictions(current, film, new_day);
+  return days + current.penalty * restrictions;
+}
+
+/* Returns a certain probability computed with the Boltzmann distribution,
+based on the difference of cost between the current solution and a certain
+neighbour and the temperature T. */
+inline double probability(double T, int cost) { return exp(-cost / T); }
+
+/* With probability p, returns true so that the worst solution between the
+current one and a certain neighbour is taken. No random number is needed when
+the outcome is certain, which is most of the time once the system is cold. */
+inline bool update(double p, Random &rng) {
+  if (p >= 1)
+    return true;
+  if (p <= 0)
+    return false;
+  double r = rng.real();
+  return not(r > p);
+}
+
+/* Kinds of moves of the annealing, and how many of every thousand moves are of
+each kind:
+- relocate: a film goes to another day with room, or to a new day.
+- swap: two films of different days exchange their days, even if both are
+  full.
+- kempe: the Kempe chain of a film between its day and another one (the films
+  of both days reachable from it through restrictions) exchanges days.
+- drain: the films of a small day go to other days, to close it. */
+enum Move_kind { relocate_move, swap_move, kempe_move, drain_move, move_kinds };
+const char *const move_names[move_kinds] = {"relocate", "swap", "kempe",
+                                            "drain"};
+const int move_weight[move_kinds] = {600, 250, 100, 50};
+
+/* Moves proposed, accepted and accepted with a lower cost of each kind (taken
+counts the accepted ones of every kind), and the working space of the moves of
+a thread: the films moved by a move and the marks of the films already in a
+Kempe chain. */
+struct Moves {
+  long long proposed[move_kinds] = {}, accepted[move_kinds] = {},
+            improving[move_kinds] = {};
+  vector<int> films, others;
+  vector<int> mark;
+  int stamp = 0;
+  long long taken = 0;
+};
+
+TRACE_COUNTER(trace_restarts, "mh.restarts");
+TRACE_COUNTER(trace_tabu_steps, "mh.tabu.steps");
+TRACE_COUNTER(trace_tabu_drains, "mh.tabu.drains");
+TRACE_COUNTER(trace_exchanges, "mh.tempering.exchanges");
+
+// Returns true if a move with the given difference of cost is taken at T.
+inline bool accepted(int cost, double T, Random &rng) {
+  return cost < 0 or update(probability(T, cost), rng);
+}
+
+// Returns a random open day other than a given one.
+inline int other_day(const Solution &s, int day, Random &rng) {
+  int r = rng.below(s.days - 1);
+  if (r >= s.open_index[day])
+    ++r;
+  return s.open_days[r];
+}
+
+/* Parameters of the annealing runs: the start and the ratio of the plain
+cooling, the moves of the schedule (after which a plain run without a better
+plan ends) and its last temperature relative to the first, the moves sampled
+to calibrate the first, the window of the adaptive cooling, the moves without
+a lower cost that make a calibrated run reheat and how many times it does
+before it gives up, and the range and first value of the adaptive penalty. */
+const double plain_start = 0.99, plain_ratio = 0.99;
+const int schedule_moves = 10000;
+const double final_ratio = 1e-3;
+const double initial_acceptance = 0.5, final_acceptance = 1e-3;
+const int calibration_moves = 200, acceptance_window = 100;
+const int stagnation_moves = 2000, max_reheats = 3;
+const int penalty_period = 100;
+const int min_penalty = 1, max_penalty = 1000, initial_penalty = 2;
+
+// Temperature of an annealing run, following the cooling chosen.
+struct Schedule {
+  Cooling cooling;
+  double start, T, alpha, beta;
+  int moves = 0;
+  long long window_taken = 0;
+
+  Schedule(Cooling cooling, double T0) : cooling(cooling) { restart(T0); }
+
+  // Starts the schedule again from a temperature.
+  void restart(double T0) {
+    start = T = T0;
+    moves = 0;
+    alpha = pow(final_ratio, 1.0 / schedule_moves);
+    beta = (1 / final_ratio - 1) / (T0 * schedule_moves);
+  }
+
+  // Lowers the temperature after a move, given the moves of the run.
+  void next(const Moves &m) {
+    ++moves;
+    if (cooling == plain)
+      T *= plain_ratio;
+    else if (cooling == geometric)
+      T *= alpha;
+    else if (cooling == lundy_mees)
+      T /= 1 + beta * T;
+    else if (moves % acceptance_window == 0) {
+      double target = initial_acceptance *
+                      pow(final_acceptance / initial_acceptance,
+                          min(1.0, double(moves) / schedule_moves));
+      double rate = double(m.taken - window_taken) / acceptance_window;
+      T *= rate > target ? 0.9 : 1 / 0.9;
+      window_taken = m.taken;
+    }
+  }
+};
+
+/* Given a planning, clears it out, so that a new one can be generated
+without declaring a new matrix. The days keep their memory. */
+inline void clear_out_plan(vector<Day> &plan) {
+  for (Day &films : plan)
+    films.clear();
+}
+
+/* State of the tabu search on a solution. tabu[film * slots + day] is the first
+iteration at which the film may go back to the day, conflicting lists the films
+with restrictions on their own day (conflicting_index locates them in it, or is
+-1) and best_restrictions is the fewest restrictions seen with the current
+number of days. */
+struct Tabu {
+  vector<long long> tabu;
+  vector<int> conflicting, conflicting_index;
+  long long iteration = 0;
+  int best_restrictions;
+};
+
+/* Buffers of a search thread: the order of the films, the plan built from it,
+and the solution and the state of the tabu search improved from it. */
+struct Arena {
+  vector<Film_info> films_info;
+  vector<Day> plan;
+  Solution current;
+  Tabu tabu;
+};
+
+// Adds a film to the conflicting films or removes it, as its day requires.
+inline void update_conflicting(const Solution &s, Tabu &t, int film) {
+  bool in_conflict = day_restrictions(s, film, s.day_of[film]) > 0;
+  bool listed = t.conflicting_index[film] >= 0;
+  if (in_conflict and not listed)
+    add_day(t.conflicting, t.conflicting_index, film);
+  else if (listed and not in_conflict) {
+    erase_day(t.conflicting, t.conflicting_index, film);
+    t.conflicting_index[film] = -1;
+  }
+}
+
+/* Threads wait on a barrier until all of them have reached it. */
+struct Barrier {
+  mutex lock;
+  condition_variable arrived;
+  int count, waiting = 0, generation = 0;
+
+  explicit Barrier(int count) : count(count) {}
+
+  void wait() {
+    unique_lock<mutex> guard(lock);
+    int current = generation;
+    if (++waiting == count) {
+      waiting = 0;
+      ++generation;
+      arrived.notify_all();
+    } else
+      arrived.wait(guard, [&] { return generation != current; });
+  }
+};
+
+// Lowest and highest temperature of the ladder and moves of each sweep.
+const double T_min = 0.05, T_max = 5.0;
+const int sweep_moves = 1000;
+
+/* With --preprocess, the seconds a component of the core is searched for the
+first time; they double each time it is searched again. */
+const double first_slice = 0.05;
+
+/* Ladder of temperatures of the parallel tempering, geometrically spaced
+between T_min and T_max. Each replica has a fixed thread and solution, and
+rank[replica] says which temperature of the ladder it is using now; replica_at
+is the inverse. cost is the cost each replica had at the end of the last
+sweep. The first replica decides in stop whether all of them have to stop, so
+that none is left waiting on the barrier. */
+struct Ladder {
+  vector<double> temperature;
+  vector<int> rank, replica_at, cost;
+  Barrier barrier;
+  bool stop = false;
+
+  explicit Ladder(int replicas) : cost(replicas, 0), barrier(replicas) {
+    for (int i = 0; i < replicas; ++i) {
+      temperature.push_back(T_min * pow(T_max / T_min, i / (replicas - 1.0)));
+      rank.push_back(i);
+      replica_at.push_back(i);
+    }
+  }
+};
+
+/* Proposes to swap the temperatures of every pair of neighbouring ranks
+(starting from the even or odd ones in turns) with the Metropolis criterion of
+parallel tempering, so that good solutions drift to the cold end. */
+inline void exchange(Ladder &ladder, int round, Random &rng) {
+  for (int i = round % 2; i + 1 < int(ladder.temperature.size()); i += 2) {
+    int a = ladder.replica_at[i], b = ladder.replica_at[i + 1];
+    double delta = (1 / ladder.temperature[i] - 1 / ladder.temperature[i + 1]) *
+                   (ladder.cost[a] - ladder.cost[b]);
+    if (delta >= 0 or rng.real() < exp(delta)) {
+      TRACE_COUNT(trace_exchanges);
+      swap(ladder.replica_at[i], ladder.replica_at[i + 1]);
+      ladder.rank[a] = i + 1;
+      ladder.rank[b] = i;
+    }
+  }
+}
+
+/* Reads the name of a cooling ("plain", "geometric", "lundy-mees" or
+"adaptive"). Returns false if it is unknown. */
+inline bool parse_cooling(const string &name, Cooling &cooling) {
+  if (name == "plain")
+    cooling = plain;
+  else if (name == "geometric")
+    cooling = geometric;
+  else if (name == "lundy-mees")
+    cooling = lundy_mees;
+  else if (name == "adaptive")
+    cooling = adaptive;
+  else
+    return false;
+  return true;
+}
+
+// Options of the search, as given on the command line.
+struct Options {
+  uint64_t seed = (uint64_t(random_device()()) << 32) | random_device()();
+  int threads = 1;
+  string mode = "restarts", engine = "anneal";
+  Construction construction = dsatur;
+  Cooling cooling = plain;
+  int penalty = max_penalty;
+  bool preprocess = false;
+  double time_limit = 0;
+  int target_days = 0;
+  string trace_file;
+};
+
+const char *const usage =
+    "[--seed N] [--threads N] [--mode restarts|tempering]"
+    " [--engine anneal|tabu] [--construct next-fit|dsatur|rlf]"
+    " [--cooling plain|geometric|lundy-mees|adaptive] [--penalty W|adaptive]"
+    " [--preprocess] [--time-limit S] [--target-days D] [--trace FILE]";
+
+/* Reads the options of the search from the arguments that follow the input and
+the output. Throws a runtime_error if one is unknown. */
+inline Options parse_options(const vector<string> &args) {
+  Options options;
+  for (size_t i = 0; i < args.size(); ++i) {
+    const string &option = args[i];
+    bool has_value = i + 1 < args.size();
+    if (option == "--seed" and has_value)
+      options.seed = strtoull(args[++i].c_str(), nullptr, 10);
+    else if (option == "--threads" and has_value)
+      options.threads = max(1, atoi(args[++i].c_str()));
+    else if (option == "--mode" and has_value and
+             (args[i + 1] == "restarts" or args[i + 1] == "tempering"))
+      options.mode = args[++i];
+    else if (option == "--engine" and has_value and
+             (args[i + 1] == "anneal" or args[i + 1] == "tabu"))
+      options.engine = args[++i];
+    else if (option == "--construct" and has_value and
+             parse_construction(args[i + 1], options.construction))
+      ++i;
+    else if (option == "--cooling" and has_value and
+             parse_cooling(args[i + 1], options.cooling))
+      ++i;
+    else if (option == "--penalty" and has_value) {
+      const string &weight = args[++i];
+      options.penalty =
+          weight == "adaptive" ? 0 : max(1, atoi(weight.c_str()));
+    } else if (option == "--time-limit" and has_value)
+      options.time_limit = atof(args[++i].c_str());
+    else if (option == "--target-days" and has_value)
+      options.target_days = atoi(args[++i].c_str());
+    else if (option == "--preprocess")
+      options.preprocess = true;
+    else if (option == "--trace" and has_value)
+      options.trace_file = args[++i];
+    else
+      throw runtime_error("unknown option " + option);
+  }
+  return options;
+}
+
+/* The search and its state. Each call of solve() searches an instance with its
+own bounds and statistics, and the threads keep their arenas from a call to the
+next, so that the batch solver reuses their memory. */
+class Solver {
+public:
+  // Writes the improved plans to the output file in the background.
+  Writer writer;
+
+  /* Where the search reports its bounds and statistics: the standard error
+  output, unless the caller sends them elsewhere, as the portfolio and the
+  daemon do. */
+  ostream *report = &cerr;
+
+  /* Tells the search of a plan of `days` days found elsewhere, as the portfolio
+  does with the plans of its other engines, so that it only publishes plans with
+  fewer (and the tabu search drains days to find them). Can be called from any
+  thread, before or while solve() runs. */
+  void offer_bound(int days) {
+    lower_bound_to(offered_days, days);
+    lower_bound_to(best_days, days);
+  }
+
+  /* Searches plans of an instance until the search is stopped, handing the ones
+  that improve to the writer, which must be open, and closes it. The time limit
+  is the caller's to set, and the times of the plans count from `start`. The
+  seed, the bounds and the statistics of the search are reported on report. */
+  Outcome solve(const Instance &input, const Options &options,
+                double start) {
+    start_time = start;
+    construction = options.construction;
+    cooling = options.cooling;
+    fixed_penalty = options.penalty;
+    preprocess = options.preprocess;
+    target_days = options.target_days;
+    double solve_start = now();
+    // the seed is reported so that any run can be repeated with --seed
+    *report << "seed: " << options.seed << endl;
+
+    /* The first plan written is the one with a film per day, so that the output
+    file is valid from the start. */
+    vector<Day> worst_plan;
+    for (int i = 0; i < input.f; ++i)
+      worst_plan.push_back({i});
+    writer.publish(worst_plan, input.f, now() - start_time);
+    written_days = input.f;
+    Bounds bounds = lower_bounds(input);
+    best_case = bounds.best();
+    report_bounds(bounds, *report);
+    total_moves = Moves();
+    if (not preprocess) {
+      optimal.days = input.f;
+      optimal.plan = worst_plan;
+      lower_bound_to(best_days, input.f);
+      if (written_days <= best_case or offered_days <= best_case)
+        request_stop(bound_reached);
+      search(input, options);
+    } else {
+      reduction = reduce_instance(input, best_case);
+      whole = &input;
+      *report << "core: " << reduction.core.size() << " films in "
+              << reduction.components.size() << " components ("
+              << reduction.peeled << " peeled, " << reduction.dominated
+              << " dominated)" << endl;
+      /* Each component starts from its DSATUR plan, and the plans are merged
+      before the removed films are put back. No plan has fewer days than the
+      bound of any component. */
+      vector<Instance> subs;
+      plans.clear();
+      for (const vector<int> &films : reduction.components) {
+        subs.push_back(sub_instance(input, films));
+        best_case = max(best_case, lower_bounds(subs.back()).best());
+        vector<int> rank(films.size());
+        for (int i = 0; i < int(films.size()); ++i)
+          rank[i] = i;
+        plans.push_back(dsatur_plan(subs.back(), rank));
+      }
+      *report << "component bound: " << best_case << endl;
+      write_plans();
+      if (written_days <= best_case or offered_days <= best_case)
+        request_stop(bound_reached);
+
+      /* The components are searched for slices of time: each time the one
+      with most days (the one searched least among them), which gets twice the
+      time it got the last time. A component with as many days as the bound
+      needs no more. */
+      vector<double> slice(subs.size(), first_slice);
+      while (not stop_requested_now()) {
+        int k = -1;
+        for (int i = 0; i < int(subs.size()); ++i)
+          if (int(plans[i].size()) > best_case and
+              (k < 0 or plans[i].size() > plans[k].size() or
+               (plans[i].size() == plans[k].size() and slice[i] < slice[k])))
+            k = i;
+        if (k < 0)
+          break;
+        component = k;
+        optimal.days = plans[k].size();
+        optimal.plan = plans[k];
+        best_days = optimal.days;
+        lower_bound_to(best_days, offered_days);
+        component_over = false;
+        component_deadline = now() + slice[k];
+        slice[k] *= 2;
+        search(subs[k], options);
+      }
+    }
+
+    TRACE_TIME("solve", now() - solve_start);
+    writer.close();
+    *report << "stopped: " << stop_description() << endl;
+    *report << "solve time: " << now() - solve_start << " s" << endl;
+    // a plan offered by another engine may be better than the ones written
+    int days = min<int>(written_days, offered_days);
+    report_gap(best_case, days, *report);
+    for (int k = 0; k < move_kinds; ++k) {
+      long long proposed = total_moves.proposed[k];
+      if (proposed == 0)
+        continue;
+      *report << move_names[k] << " moves: " << proposed << " proposed, "
+              << 100.0 * total_moves.accepted[k] / proposed << "% accepted, "
+              << 100.0 * total_moves.improving[k] / proposed << "% improving"
+              << endl;
+    }
+    // the bounds offered only hold for this call
+    best_days = numeric_limits<int>::max();
+    offered_days = numeric_limits<int>::max();
+    return {days, days <= best_case};
+  }
+
+private:
+  int f, l, c;
+  double start_time;
+
+  /* No plan can have less than best_case days, and the search stops once it
+  finds one with target_days days (if not 0). */
+  int best_case, target_days = 0;
+
+  // How the first plan of each search is built and how the annealing cools.
+  Construction construction = dsatur;
+  Cooling cooling = plain;
+
+  /* Weight of a restriction in the cost of the annealing. If 0 (with --penalty
+  adaptive), each run starts with initial_penalty and adapts it: it grows while
+  the solution keeps some restriction for a whole penalty_period, and shrinks
+  while it keeps none, so that the search spends its time near the edge of the
+  plans without restrictions. The tabu search and the tempering (whose replicas
+  compare their costs) use max_penalty instead. */
+  int fixed_penalty = max_penalty;
+
+  /* With --preprocess the search runs on the components of the core of the
+  instance read, whole, and the plans of the components are put back into plans
+  of whole before they are written. plans keeps the best plan of each
+  component, in films of the component, and `component` is the one being
+  searched, until component_deadline or until component_over is set.
+  written_days are the days of the last plan written. */
+  bool preprocess = false;
+  const Instance *whole;
+  Reduction reduction;
+  vector<vector<Day>> plans;
+  int component;
+  double component_deadline;
+  atomic<bool> component_over{false};
+  int written_days;
+
+  /* Given a matrix with the best planning of d days, hands it to the writer,
+  which writes it in the output format. */
+  void write(const vector<Day> &plan, int d) {
+    if (preprocess) {
+      plans[component].assign(plan.begin(), plan.begin() + d);
+      write_plans();
+      return;
+    }
+    written_days = d;
+    writer.publish(plan, d, now() - start_time);
+  }
+
+  /* Merges the plans of the components, puts the removed films back and hands
+  the plan to the writer if it has fewer days than the last one written. */
+  void write_plans() {
+    vector<Day> restored =
+        restore_component_plans(*whole, reduction, plans, best_case);
+    if (int(restored.size()) >= written_days)
+      return;
+    written_days = restored.size();
+    writer.publish(move(restored), written_days, now() - start_time);
+  }
+
+  /* Returns true if the search has to stop, or with --preprocess, if the
+  component searched is done. Like stop_requested(), it only reads the clock
+  once every 1024 calls. */
+  bool search_over() {
+    if (stop_requested())
+      return true;
+    if (not preprocess)
+      return false;
+    thread_local unsigned calls = 0;
+    if (++calls % 1024 == 0 and now() >= component_deadline)
+      component_over = true;
+    return component_over.load(memory_order_relaxed);
+  }
+
+  /* Runs the search asked for on an instance, on as many threads as asked,
+  until it is over. */
+  void search(const Instance &festival, const Options &options) {
+    f = festival.f;
+    l = festival.l;
+    c = festival.c;
+    adjacency_start = festival.adjacency_start.data();
+    adjacency = festival.adjacency.data();
+
+    /* Each thread (or replica of the ladder) gets its own generator, seeded
+    from the one given so that the run can be repeated. */
+    int threads = options.threads;
+    uint64_t seed = options.seed;
+    vector<thread> pool;
+    Ladder ladder(max(threads, 2));
+    if (arenas.size() < ladder.rank.size())
+      arenas.resize(ladder.rank.size());
+    if (options.engine == "tabu") {
+      for (int i = 1; i < threads; ++i)
+        pool.push_back(scoped_thread(&Solver::tabu_search, this, cref(festival),
+                                     ref(arenas[i]), seed + i));
+      tabu_search(festival, arenas[0], seed);
+    } else if (options.mode == "restarts") {
+      for (int i = 1; i < threads; ++i)
+        pool.push_back(scoped_thread(&Solver::restarts, this, cref(festival),
+                                     ref(arenas[i]), seed + i));
+      restarts(festival, arenas[0], seed);
+    } else {
+      for (int i = 1; i < int(ladder.rank.size()); ++i)
+        pool.push_back(scoped_thread(&Solver::tempering, this, cref(festival),
+                                     ref(ladder), i, ref(arenas[i]), seed + i));
+      tempering(festival, ladder, 0, arenas[0], seed);
+    }
+    for (thread &t : pool)
+      t.join();
+  }
+
+  /* Given the films' informations, it will make the plan
+  in a number d of days using a greedy algorithm. */
+  void generate_planning(const Instance &festival,
+                         const vector<Film_info> &films_info, vector<Day> &plan,
+                         int &d) {
+    // only the last day can receive films, so we keep its conflicts
+    vector<uint64_t> day_conflicts(festival.words, 0);
+
+    // The most restricted film is put on the first day of the plan
+    plan_film(festival, films_info[0], plan[0], day_conflicts);
+
+    for (int i = 1; i < f; ++i) {
+      /* the next most restricted film is inserted on the plan, checking if it
+      is possible to do it on the same day or if we will need to go to the next
+      one */
+
+      if (int(plan[d].size()) == c or
+          restricted(day_conflicts, films_info[i])) {
+        clear_conflicts(festival, plan[d], day_conflicts.data());
+        d += 1;
+      }
+      plan_film(festival, films_info[i], plan[d], day_conflicts);
+    }
+  }
+
+  /* Films in conflict with each film, in compressed form: the neighbours of
+  film i are adjacency[adjacency_start[i]] to adjacency[adjacency_start[i + 1] -
+  1]. They point to the lists of the instance. */
+  const int *adjacency_start, *adjacency;
+
+  /* Adds empty days to a solution, doubling its slots and spreading the
+  counters of restrictions to the new width. */
+  void add_slots(Solution &s) {
+    int slots = 2 * s.slots;
+    vector<int> conflicts(size_t(f) * slots, 0);
+    for (int i = 0; i < f; ++i) {
+      const int *row = s.conflicts.data() + size_t(i) * s.slots;
+      copy(row, row + s.slots, conflicts.data() + size_t(i) * slots);
+    }
+    s.conflicts.swap(conflicts);
+    s.plan.resize(slots);
+    s.open_index.resize(slots, -1);
+    s.free_index.resize(slots, -1);
+    for (int d = slots - 1; d >= s.slots; --d)
+      s.empty_days.push_back(d);
+    s.slots = slots;
+  }
+
+  /* Places a film on a day of a solution, updating the counters of its
+  conflicts. */
+  void place_film(Solution &s, int film, int day) {
+    if (s.plan[day].empty()) {
+      add_day(s.open_days, s.open_index, day);
+      add_day(s.free_days, s.free_index, day);
+      ++s.days;
+    }
+    s.day_of[film] = day;
+    s.position[film] = s.plan[day].size();
+    s.plan.push(day, film);
+    if (int(s.plan[day].size()) == c)
+      erase_day(s.free_days, s.free_index, day);
+    for (int j = adjacency_start[film]; j < adjacency_start[film + 1]; ++j)
+      ++day_restrictions(s, adjacency[j], day);
+  }
+
+  /* Removes a film from its day, moving the last film of the day to its
+  position so that no other entry of the plan changes. */
+  void remove_film(Solution &s, int film) {
+    int day = s.day_of[film];
+    if (int(s.plan[day].size()) == c)
+      add_day(s.free_days, s.free_index, day);
+    int last = s.plan[day].back();
+    s.plan.set(day, s.position[film], last);
+    s.position[last] = s.position[film];
+    s.plan.pop(day);
+    for (int j = adjacency_start[film]; j < adjacency_start[film + 1]; ++j)
+      --day_restrictions(s, adjacency[j], day);
+    if (s.plan[day].empty()) {
+      erase_day(s.open_days, s.open_index, day);
+      erase_day(s.free_days, s.free_index, day);
+      s.empty_days.push_back(day);
+      --s.days;
+    }
+  }
+
+  /* Completes the parameters of a certain solution, based on a given planning
+  of d + 1 days, reusing the memory it had. A day of the plan has room for 2c
+  films, as an exchange of films between two days fills one of them before it
+  empties the other. */
+  void fill_solution(Solution &current, const vector<Day> &plan, int d,
+                     int penalty) {
+    current.slots = d + 2;
+    current.plan.assign(current.slots, min(2 * c, f));
+    current.day_of.assign(f, -1);
+    current.position.assign(f, -1);
+    current.open_days.clear();
+    current.free_days.clear();
+    current.open_index.assign(current.slots, -1);
+    current.free_index.assign(current.slots, -1);
+    current.conflicts.assign(size_t(f) * current.slots, 0);
+    current.empty_days = {d + 1};
+    current.days = 0;
+    current.restrictions = 0;
+    for (int day = 0; day <= d; ++day) {
+      for (int film : plan[day]) {
+        current.restrictions += day_restrictions(current, film, day);
+        place_film(current, film, day);
+      }
+    }
+    current.penalty = penalty;
+    current.cost = current.days + penalty * current.restrictions;
+  }
+
+  /* Chooses a film of a random day and a different day with room for it to move
+  it to, or -1 if it has to go to a new day. Both days are drawn directly among
+  the valid ones, so no draw is ever repeated. */
+  void find_neighbour(const Solution &current, Random &rng, int &film,
+                      int &new_day) {
+    int old_day = current.open_days[rng.below(current.days)];
+    film = current.plan[old_day][rng.below(current.plan[old_day].size())];
+
+    /* the new day is one of the days with room other than the old one, or the
+    last choice, which stands for a new day */
+    bool old_free = int(current.plan[old_day].size()) < c;
+    int choices = current.free_days.size() - old_free + 1;
+    int r = rng.below(choices);
+    if (r == choices - 1)
+      new_day = -1;
+    else {
+      if (old_free and r >= current.free_index[old_day])
+        ++r;
+      new_day = current.free_days[r];
+    }
+  }
+
+  // Moves a film to another day, or to a new one if new_day is -1.
+  void move_film(Solution &current, int film, int new_day, int cost) {
+    remove_film(current, film);
+    if (new_day == -1) {
+      if (current.empty_days.empty())
+        add_slots(current);
+      new_day = current.empty_days.back();
+      current.empty_days.pop_back();
+    }
+    current.restrictions +=
+        day_restrictions(current, film, new_day) -
+        day_restrictions(current, film, current.day_of[film]);
+    place_film(current, film, new_day);
+    current.cost += cost;
+  }
+
+  /* The best plan found by any thread. best_days can be read without locking to
+  discard plans that do not improve it; optimal and the output file are only
+  touched holding best_mutex, so there is a single writer at a time. */
+  atomic<int> best_days{numeric_limits<int>::max()};
+  mutex best_mutex;
+  Best optimal;
+
+  // Days of the best plan found elsewhere and offered to the search, if any.
+  atomic<int> offered_days{numeric_limits<int>::max()};
+
+  /* Keeps and writes a solution without restrictions if it improves the best
+  one. */
+  void publish(const Solution &s) {
+    if (s.restrictions > 0 or s.days >= best_days)
+      return;
+    lock_guard<mutex> guard(best_mutex);
+    if (s.days < best_days) {
+      optimal = snapshot(s);
+      lower_bound_to(best_days, s.days);
+      write(optimal.plan, optimal.days);
+      /* the plan written decides: with --preprocess, putting the removed films
+      back may open days */
+      if (written_days <= best_case)
+        request_stop(bound_reached);
+      else if (written_days <= target_days)
+        request_stop(target_reached);
+      else if (preprocess and optimal.days <= best_case)
+        component_over = true;
+    }
+  }
+
+  // Buffers of each thread, kept from a call to the next.
+  vector<Arena> arenas;
+
+  // Statistics of the moves of every thread that has finished.
+  Moves total_moves;
+  mutex moves_mutex;
+
+  // Adds the statistics of the moves of a thread to the total.
+  void add_moves(const Moves &m) {
+    lock_guard<mutex> guard(moves_mutex);
+    for (int k = 0; k < move_kinds; ++k) {
+      total_moves.proposed[k] += m.proposed[k];
+      total_moves.accepted[k] += m.accepted[k];
+      total_moves.improving[k] += m.improving[k];
+      TRACE_TOTAL(string("mh.moves.") + move_names[k] + ".proposed",
+                  m.proposed[k]);
+      TRACE_TOTAL(string("mh.moves.") + move_names[k] + ".accepted",
+                  m.accepted[k]);
+      TRACE_TOTAL(string("mh.moves.") + move_names[k] + ".improving",
+                  m.improving[k]);
+    }
+  }
+
+  // Moves some films to a day, adding the difference of cost of each move.
+  void move_films(Solution &s, const vector<int> &films, int day) {
+    for (int film : films)
+      move_film(s, film, day, move_cost(s, film, day));
+  }
+
+  /* Exchanges the days of the films m.films, of day a, and m.others, of day b.
+  The films of a day that keeps some film move first, so that no film is ever
+  moved to a day left empty by the move. */
+  void exchange_films(Solution &s, const Moves &m, int a, int b) {
+    if (m.films.size() < s.plan[a].size()) {
+      move_films(s, m.films, b);
+      move_films(s, m.others, a);
+    } else {
+      move_films(s, m.others, a);
+      move_films(s, m.films, b);
+    }
+  }
+
+  /* Proposes to swap a random film with a random film of another day, and
+  returns true if the swap is taken, with its difference of cost. The difference
+  comes from the counters of restrictions, minus the restriction between both
+  films, if any, which both counters include. */
+  bool swap_step(const Instance &festival, Solution &s, double T, Random &rng,
+                 Moves &m, int &cost) {
+    int a = s.open_days[rng.below(s.days)], b = other_day(s, a, rng);
+    int v = s.plan[a][rng.below(s.plan[a].size())];
+    int w = s.plan[b][rng.below(s.plan[b].size())];
+    // exchanging the only films of two days changes nothing
+    if (s.plan[a].size() == 1 and s.plan[b].size() == 1)
+      return false;
+    int restrictions = day_restrictions(s, v, b) - day_restrictions(s, v, a) +
+                       day_restrictions(s, w, a) - day_restrictions(s, w, b);
+    if (festival.restricted(v, w))
+      restrictions -= 2;
+    cost = s.penalty * restrictions;
+    if (not accepted(cost, T, rng))
+      return false;
+    m.films.assign(1, v);
+    m.others.assign(1, w);
+    exchange_films(s, m, a, b);
+    return true;
+  }
+
+  /* Proposes to exchange the days of the Kempe chain of a random film and
+  another day, if it fits in the cinemas, and returns true if the exchange is
+  taken, with its difference of cost. While the chain is built, each film adds
+  the difference of its own counters of restrictions, and each restriction
+  inside the chain corrects it: two films of the same day that stay together
+  were counted as leaving each other, and two films of different days that
+  exchange them were counted as meeting. */
+  bool kempe_step(Solution &s, double T, Random &rng, Moves &m, int &cost) {
+    int a = s.open_days[rng.below(s.days)], b = other_day(s, a, rng);
+    int film = s.plan[a][rng.below(s.plan[a].size())];
+    if (m.mark.empty())
+      m.mark.assign(f, 0);
+    ++m.stamp;
+    m.films.assign(1, film);
+    m.mark[film] = m.stamp;
+    int restrictions = 0;
+    for (int i = 0; i < int(m.films.size()); ++i) {
+      int u = m.films[i], from = s.day_of[u], to = from == a ? b : a;
+      restrictions += day_restrictions(s, u, to) - day_restrictions(s, u, from);
+      for (int j = adjacency_start[u]; j < adjacency_start[u + 1]; ++j) {
+        int x = adjacency[j], day = s.day_of[x];
+        if (day != a and day != b)
+          continue;
+        restrictions += day == from ? 1 : -1;
+        if (m.mark[x] != m.stamp) {
+          m.mark[x] = m.stamp;
+          m.films.push_back(x);
+        }
+      }
+    }
+
+    // the chain is split in its films of a (in films) and of b (in others)
+    m.others.clear();
+    int kept = 0;
+    for (int u : m.films) {
+      if (s.day_of[u] == a)
+        m.films[kept++] = u;
+      else
+        m.others.push_back(u);
+    }
+    m.films.resize(kept);
+    int size_a = s.plan[a].size() - m.films.size() + m.others.size();
+    int size_b = s.plan[b].size() - m.others.size() + m.films.size();
+    // exchanging two whole days changes nothing
+    if (size_a > c or size_b > c or
+        (m.films.size() == s.plan[a].size() and
+         m.others.size() == s.plan[b].size()))
+      return false;
+    cost = s.penalty * restrictions - (size_a == 0 ? 1 : 0);
+    if (not accepted(cost, T, rng))
+      return false;
+    exchange_films(s, m, a, b);
+    return true;
+  }
+
+  /* Proposes to close the smallest of three random days, moving each of its
+  films to the day with room where it has fewest restrictions among three random
+  ones, and returns true if it is taken, with its difference of cost. The move
+  is made to know its cost, and undone if it is rejected: the closed day is the
+  last empty one, so the first film taken back reopens it. */
+  bool drain_step(Solution &s, double T, Random &rng, Moves &m, int &cost) {
+    if ((s.days - 1) * c < f)
+      return false;
+    int day = s.open_days[rng.below(s.days)];
+    for (int i = 0; i < 2; ++i) {
+      int other = s.open_days[rng.below(s.days)];
+      if (s.plan[other].size() < s.plan[day].size())
+        day = other;
+    }
+
+    m.films.assign(s.plan[day].begin(), s.plan[day].end());
+    cost = 0;
+    for (int film : m.films) {
+      int best = -1;
+      for (int i = 0; i < 3; ++i) {
+        int candidate = s.free_days[rng.below(s.free_days.size())];
+        if (candidate != day and
+            (best < 0 or day_restrictions(s, film, candidate) <
+                             day_restrictions(s, film, best)))
+          best = candidate;
+      }
+      for (int i = 0; best < 0; ++i)
+        if (s.free_days[i] != day)
+          best = s.free_days[i];
+      int film_cost = move_cost(s, film, best);
+      move_film(s, film, best, film_cost);
+      cost += film_cost;
+    }
+    if (accepted(cost, T, rng))
+      return true;
+    move_film(s, m.films[0], -1, move_cost(s, m.films[0], -1));
+    for (int i = 1; i < int(m.films.size()); ++i)
+      move_film(s, m.films[i], day, move_cost(s, m.films[i], day));
+    return false;
+  }
+
+  /* Proposes a random move of a random kind and takes it if it is accepted at
+  temperature T. Returns the difference of cost of the move, or 0 if it was
+  rejected. */
+  int anneal_step(const Instance &festival, Solution &current, double T,
+                  Random &rng, Moves &m) {
+    int r = rng.below(1000), kind = 0;
+    while (r >= move_weight[kind])
+      r -= move_weight[kind++];
+    // the other moves need two days
+    if (current.days < 2)
+      kind = relocate_move;
+    ++m.proposed[kind];
+
+    int cost;
+    bool taken;
+    if (kind == relocate_move) {
+      int film, new_day;
+      find_neighbour(current, rng, film, new_day);
+      cost = move_cost(current, film, new_day);
+      taken = accepted(cost, T, rng);
+      if (taken)
+        move_film(current, film, new_day, cost);
+    } else if (kind == swap_move)
+      taken = swap_step(festival, current, T, rng, m, cost);
+    else if (kind == kempe_move)
+      taken = kempe_step(current, T, rng, m, cost);
+    else
+      taken = drain_step(current, T, rng, m, cost);
+    if (not taken)
+      return 0;
+    ++m.taken;
+    ++m.accepted[kind];
+    if (cost < 0)
+      ++m.improving[kind];
+    return cost;
+  }
+
+  /* Returns the temperature at which the average move raising the cost of a
+  solution is accepted with probability initial_acceptance, measured on random
+  relocations (which are not made). */
+  double initial_temperature(const Solution &s, Random &rng) {
+    double rise = 0;
+    int rises = 0;
+    for (int i = 0; i < calibration_moves; ++i) {
+      int film, new_day;
+      find_neighbour(s, rng, film, new_day);
+      int cost = move_cost(s, film, new_day);
+      if (cost > 0) {
+        rise += cost;
+        ++rises;
+      }
+    }
+    return rises == 0 ? 1 : rise / rises / -log(initial_acceptance);
+  }
+
+  /* Applies a simulated annealing algorithm, where temperature is reduced at
+  each iteration and moves resulting in solutions of worse quality than the
+  current one are allowed in order to escape from local optima. Moves are
+  evaluated and applied in place, so an iteration only touches the moved film
+  and its conflicts. With the plain cooling, a run ends schedule_moves moves
+  after the last better plan it found. With the others, the first temperature
+  is calibrated on the solution; when the cost stops falling the run reheats to
+  half the temperature it last started from, and it ends when it stops falling
+  after max_reheats reheats with no better plan found. */
+  void simulated_annealing(const Instance &festival, const vector<Day> &plan,
+                           int &d, Solution &current, Random &rng, Moves &m) {
+    fill_solution(current, plan, d,
+                  fixed_penalty > 0 ? fixed_penalty : initial_penalty);
+    publish(current);
+
+    Schedule schedule(cooling, cooling == plain
+                                   ? plain_start
+                                   : initial_temperature(current, rng));
+    schedule.window_taken = m.taken;
+    int lowest = current.cost, since_lowest = 0, reheats = 0, infeasible = 0;
+    int since_better = 0;
+    for (int k = 1; not search_over(); ++k) {
+      /* with a low penalty a move can remove the last restriction at no cost,
+      so every move taken is checked, whatever its cost */
+      long long taken = m.taken;
+      anneal_step(festival, current, schedule.T, rng, m);
+      if (m.taken != taken and current.restrictions == 0 and
+          current.days < best_days) {
+        publish(current);
+        reheats = 0;
+        since_better = 0;
+      }
+
+      /* the penalty is adapted to the share of the period spent with
+      restrictions, and the costs are taken again with it */
+      infeasible += current.restrictions > 0;
+      if (fixed_penalty == 0 and k % penalty_period == 0) {
+        int penalty = current.penalty;
+        if (infeasible == penalty_period)
+          penalty = min(max_penalty, penalty * 3 / 2 + 1);
+        else if (infeasible == 0)
+          penalty = max(min_penalty, penalty * 2 / 3);
+        if (penalty != current.penalty) {
+          current.penalty = penalty;
+          current.cost = current.days + penalty * current.restrictions;
+          lowest = current.cost;
+        }
+        infeasible = 0;
+      }
+
+      if (cooling == plain) {
+        if (++since_better == schedule_moves)
+          break;
+      } else if (current.cost < lowest) {
+        lowest = current.cost;
+        since_lowest = 0;
+      } else if (++since_lowest == stagnation_moves) {
+        if (reheats == max_reheats)
+          break;
+        ++reheats;
+        schedule.restart(schedule.start / 2);
+        lowest = current.cost;
+        since_lowest = 0;
+      }
+      if (k % 1000 == 0) {
+        TRACE_SAMPLE("temperature", schedule.T);
+        TRACE_SAMPLE("cost", current.cost);
+        TRACE_SAMPLE("penalty", current.penalty);
+      }
+      schedule.next(m);
+    }
+  }
+
+  /* Generates a new plan after sorting the films randomly, so that a different
+  one is generated every time: the greedy one takes the films in that order, and
+  DSATUR and RLF break their ties with it. The plan keeps its f days. */
+  void random_planning(const Instance &festival, vector<Film_info> &films_info,
+                       vector<Day> &plan, int &d, Random &rng) {
+    shuffle(films_info.begin(), films_info.end(), rng);
+    d = 0;
+    clear_out_plan(plan);
+    if (construction == next_fit) {
+      generate_planning(festival, films_info, plan, d);
+      return;
+    }
+    vector<int> rank(f);
+    for (int i = 0; i < f; ++i)
+      rank[films_info[i].idx] = i;
+    plan = construction == dsatur ? dsatur_plan(festival, rank)
+                                  : rlf_plan(festival, rank);
+    d = plan.size() - 1;
+    plan.resize(f);
+  }
+
+  // Gives the films of an arena their order by index and the plan its f days.
+  void start_arena(Arena &a) {
+    a.films_info.resize(f);
+    for (int i = 0; i < f; ++i)
+      a.films_info[i].idx = i;
+    a.plan.resize(f);
+  }
+
+  /* Loop of independent restarts until the search is stopped: a random greedy
+  plan is generated and improved with simulated annealing. Several threads can
+  run it at once, each one with its own seed and arena, sharing the best
+  plan. */
+  void restarts(const Instance &festival, Arena &a, uint64_t seed) {
+    Random rng(seed);
+    start_arena(a);
+    int d;
+    Moves m;
+    while (not search_over()) {
+      TRACE_COUNT(trace_restarts);
+      random_planning(festival, a.films_info, a.plan, d, rng);
+      simulated_annealing(festival, a.plan, d, a.current, rng, m);
+    }
+    add_moves(m);
+  }
+
+  /* Moves a film to another day of the tabu search. Only the film and the films
+  in conflict with it can change their conflicting state. */
+  void tabu_move(Solution &s, Tabu &t, int film, int day) {
+    move_film(s, film, day, move_cost(s, film, day));
+    update_conflicting(s, t, film);
+    for (int j = adjacency_start[film]; j < adjacency_start[film + 1]; ++j)
+      update_conflicting(s, t, adjacency[j]);
+  }
+
+  /* Empties the day with fewest films, moving each of its films to the day with
+  room where it has fewest restrictions, so that the search goes on with a day
+  less. Returns false if the other days have no room for all the films. */
+  bool drain_day(Solution &s, Tabu &t, Random &rng) {
+    if ((s.days - 1) * c < f)
+      return false;
+    int drained = s.open_days[0];
+    for (int day : s.open_days)
+      if (s.plan[day].size() < s.plan[drained].size())
+        drained = day;
+    while (not s.plan[drained].empty()) {
+      int film = s.plan[drained].back();
+      int best = -1, ties = 0;
+      for (int day : s.free_days) {
+        if (day == drained)
+          continue;
+        if (best < 0 or
+            day_restrictions(s, film, day) < day_restrictions(s, film, best)) {
+          best = day;
+          ties = 1;
+        } else if (day_restrictions(s, film, day) ==
+                       day_restrictions(s, film, best) and
+                   rng.below(++ties) == 0)
+          best = day;
+      }
+      tabu_move(s, t, film, best);
+    }
+    t.best_restrictions = s.restrictions;
+    return true;
+  }
+
+  /* Makes the best move of a conflicting film to another open day that is not
+  tabu, unless it leads to fewer restrictions than ever with these days. If the
+  day is full, the film is swapped with a random film of it. The counters of
+  restrictions give the difference of each move in O(1). Returns false if every
+  move is tabu. */
+  bool tabu_step(const Instance &festival, Solution &s, Tabu &t, Random &rng) {
+    int best_delta = 0, ties = 0, film = -1, day = -1, other = -1;
+    for (int v : t.conflicting) {
+      int old_day = s.day_of[v];
+      int leave = day_restrictions(s, v, old_day);
+      for (int d : s.open_days) {
+        if (d == old_day)
+          continue;
+        int w = -1;
+        int delta = day_restrictions(s, v, d) - leave;
+        if (int(s.plan[d].size()) == c) {
+          w = s.plan[d][rng.below(c)];
+          delta += day_restrictions(s, w, old_day) - day_restrictions(s, w, d);
+          // the restriction between both films is counted by both moves
+          if (festival.restricted(v, w))
+            delta -= 2;
+        }
+        bool is_tabu = t.tabu[size_t(v) * s.slots + d] > t.iteration or
+                       (w >= 0 and t.tabu[size_t(w) * s.slots + old_day] >
+                                       t.iteration);
+        if (is_tabu and s.restrictions + delta >= t.best_restrictions)
+          continue;
+        if (film < 0 or delta < best_delta) {
+          ties = 1;
+        } else if (delta > best_delta or rng.below(++ties) != 0)
+          continue;
+        best_delta = delta;
+        film = v;
+        day = d;
+        other = w;
+      }
+    }
+    ++t.iteration;
+    TRACE_COUNT(trace_tabu_steps);
+    if (t.iteration % 1000 == 0)
+      TRACE_SAMPLE("restrictions", s.restrictions);
+    if (film < 0)
+      return false;
+
+    /* The film of the full day goes first, so that the old day of the film is
+    never left empty in between. */
+    int old_day = s.day_of[film];
+    if (other >= 0)
+      tabu_move(s, t, other, old_day);
+    tabu_move(s, t, film, day);
+
+    // the tenure grows with the number of films in conflict
+    long long tenure = rng.below(10) + (6 * t.conflicting.size()) / 10;
+    t.tabu[size_t(film) * s.slots + old_day] = t.iteration + tenure;
+    if (other >= 0)
+      t.tabu[size_t(other) * s.slots + day] = t.iteration + tenure;
+    t.best_restrictions = min(t.best_restrictions, s.restrictions);
+    return true;
+  }
+
+  /* Tabu search for a fixed number of days (TabuCol). Starting from a random
+  greedy plan, it moves films to remove restrictions without opening days; when
+  none is left, the plan is kept and the day with fewest films is drained to try
+  with one day less. It also drains days when another thread finds a plan with
+  as few days. Runs until the search is stopped or the days cannot hold the
+  films. */
+  void tabu_search(const Instance &festival, Arena &a, uint64_t seed) {
+    Random rng(seed);
+    start_arena(a);
+    int d;
+    random_planning(festival, a.films_info, a.plan, d, rng);
+    Solution &s = a.current;
+    fill_solution(s, a.plan, d, max_penalty);
+
+    Tabu &t = a.tabu;
+    t.tabu.assign(size_t(f) * s.slots, 0);
+    t.conflicting.clear();
+    t.conflicting_index.assign(f, -1);
+    t.iteration = 0;
+    t.best_restrictions = s.restrictions;
+    while (not search_over()) {
+      if (s.restrictions == 0)
+        publish(s);
+      if (s.days >= best_days) {
+        TRACE_COUNT(trace_tabu_drains);
+        if (not drain_day(s, t, rng))
+          return;
+      } else
+        tabu_step(festival, s, t, rng);
+    }
+  }
+
+  /* Loop of a replica of the parallel tempering until the search is stopped.
+  Each replica anneals its solution for a sweep at the temperature of its rank;
+  then all of them wait and the first one proposes the exchanges of
+  temperatures. */
+  void tempering(const Instance &festival, Ladder &ladder, int replica,
+                 Arena &a, uint64_t seed) {
+    Random rng(seed);
+    start_arena(a);
+    int d;
+    random_planning(festival, a.films_info, a.plan, d, rng);
+    Solution &current = a.current;
+    fill_solution(current, a.plan, d,
+                  fixed_penalty > 0 ? fixed_penalty : max_penalty);
+    publish(current);
+
+    Moves m;
+    for (int round = 0; not ladder.stop; ++round) {
+      double T = ladder.temperature[ladder.rank[replica]];
+      for (int k = 0; k < sweep_moves and not search_over(); ++k) {
+        long long taken = m.taken;
+        anneal_step(festival, current, T, rng, m);
+        if (m.taken != taken and current.restrictions == 0 and
+            current.days < best_days)
+          publish(current);
+      }
+      ladder.cost[replica] = current.cost;
+      ladder.barrier.wait();
+      if (replica == 0) {
+        exchange(ladder, round, rng);
+        ladder.stop = stop_flagged() or component_over;
+        TRACE_SAMPLE("cold cost", ladder.cost[ladder.replica_at[0]]);
+      }
+      ladder.barrier.wait();
+    }
+    add_moves(m);
+  }
+};
+
+} // namespace mh
+
+#endif
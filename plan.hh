@@ -0,0 +1,81 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Flat plan for the searches that change a plan millions of times. Day d keeps
+its films in slots[d * width] to slots[d * width + size[d] - 1], so the whole
+plan is two arrays: adding or removing a film never allocates, emptying the
+plan only resets the sizes and copying it copies two arrays. The width is the
+most films a day can take, which the search gives: never over f, so the slots
+never outgrow the conflict counters the searches keep for every film and day. */
+
+#ifndef PLAN_HH
+#define PLAN_HH
+
+#include <algorithm>
+#include <vector>
+
+#include "festival.hh"
+using namespace std;
+
+class Flat_plan {
+public:
+  // Films of a day, read like a Day. It is valid until the plan is resized.
+  class Day_view {
+  public:
+    Day_view(const int *first, int count) : first(first), count(count) {}
+    const int *begin() const { return first; }
+    const int *end() const { return first + count; }
+    size_t size() const { return count; }
+    bool empty() const { return count == 0; }
+    int operator[](int k) const { return first[k]; }
+    int back() const { return first[count - 1]; }
+
+  private:
+    const int *first;
+    int count;
+  };
+
+  // Makes the plan `days` empty days of `width` films.
+  void assign(int days, int width) {
+    this->width = width;
+    slots.assign(size_t(days) * width, -1);
+    sizes.assign(days, 0);
+  }
+
+  // Changes the number of days, keeping the films of the days that are left.
+  void resize(int days) {
+    slots.resize(size_t(days) * width, -1);
+    sizes.resize(days, 0);
+  }
+
+  // Empties every day.
+  void clear() { fill(sizes.begin(), sizes.end(), 0); }
+
+  int days() const { return sizes.size(); }
+
+  Day_view operator[](int d) const {
+    return Day_view(&slots[size_t(d) * width], sizes[d]);
+  }
+
+  // Adds a film at the end of a day, which must have room for it.
+  void push(int d, int film) { slots[size_t(d) * width + sizes[d]++] = film; }
+
+  // Removes the last film of a day.
+  void pop(int d) { --sizes[d]; }
+
+  // Puts a film at position k of a day, in place of the one that was there.
+  void set(int d, int k, int film) { slots[size_t(d) * width + k] = film; }
+
+  // Returns the first `days` days as a list of days, as the writer takes them.
+  vector<Day> to_days(int days) const {
+    vector<Day> plan(days);
+    for (int d = 0; d < days; ++d)
+      plan[d].assign((*this)[d].begin(), (*this)[d].end());
+    return plan;
+  }
+
+private:
+  vector<int> slots, sizes;
+  int width = 0;
+};
+
+#endif
@@ -0,0 +1,174 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Portfolio solver: the constructive heuristics, the metaheuristic and the
+exhaustive search on one instance at the same time, sharing one output file.
+
+  portfolio input output [--threads N] [--time-limit S] [--seed N]
+                         [--trace FILE]
+
+The best plan of DSATUR and RLF, which take milliseconds, is written first and
+offered to the other two engines, which then run concurrently: the tabu search
+of mh on a thread for every two given (one at least) and the search of exh on
+the rest (one at least). Every plan either of them finds goes to the incumbent,
+which writes it only if it has fewer days than the last one written, and offers
+its days to both: the exhaustive search prunes against them, so it only has to
+prove that no plan has fewer days, and the tabu search drains a day below
+them.
+
+The portfolio stops when a plan reaches the lower bound, when the search has
+explored its whole tree (which proves the incumbent optimal), or at the time
+limit. The reports of the engines are written at the end, each line after the
+name of its engine. */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "bounds.hh"
+#include "construct.hh"
+#include "control.hh"
+#include "exh.hh"
+#include "festival.hh"
+#include "mh.hh"
+#include "trace.hh"
+#include "writer.hh"
+using namespace std;
+
+/* The best plan of the portfolio, and the engine that found it. The engines
+hand their plans to it from the threads of their writers, and it offers their
+days to both searches. */
+struct Incumbent {
+  mutex lock;
+  string output_file;
+  int days = numeric_limits<int>::max();
+  string engine;
+  mh::Solver *heuristic;
+  exh::Solver *search;
+
+  /* Writes a plan of `days` days in the output format if it improves the
+  incumbent, and offers its days to the searches. */
+  void offer(int days, const string &text, const string &engine) {
+    lock_guard<mutex> guard(lock);
+    if (days >= this->days)
+      return;
+    this->days = days;
+    this->engine = engine;
+    if (not replace_file(output_file, text))
+      cerr << "cannot write " << output_file << endl;
+    heuristic->offer_bound(days);
+    search->offer_bound(days);
+  }
+};
+
+// Writes the report of an engine, each line after its name.
+void print_report(const string &engine, const ostringstream &report) {
+  istringstream lines(report.str());
+  string line;
+  while (getline(lines, line))
+    cerr << engine << ": " << line << endl;
+}
+
+int main(int argc, char **argv) {
+  if (argc < 3) {
+    cerr << "usage: " << argv[0]
+         << " input output [--threads N] [--time-limit S] [--seed N]"
+            " [--trace FILE]"
+         << endl;
+    return 1;
+  }
+  string input_file = argv[1];
+  mh::Solver heuristic_engine;
+  exh::Solver search_engine;
+  Incumbent incumbent;
+  incumbent.output_file = argv[2];
+  incumbent.heuristic = &heuristic_engine;
+  incumbent.search = &search_engine;
+  int threads = max(2u, thread::hardware_concurrency());
+  double time_limit = 0;
+  mh::Options mh_options;
+  exh::Options exh_options;
+  string trace_file;
+  for (int i = 3; i < argc; ++i) {
+    string option = argv[i];
+    if (option == "--threads" and i + 1 < argc)
+      threads = max(1, atoi(argv[++i]));
+    else if (option == "--time-limit" and i + 1 < argc)
+      time_limit = atof(argv[++i]);
+    else if (option == "--seed" and i + 1 < argc)
+      mh_options.seed = strtoull(argv[++i], nullptr, 10);
+    else if (option == "--trace" and i + 1 < argc)
+      trace_file = argv[++i];
+    else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+  mh_options.engine = "tabu";
+  mh_options.threads = max(1, threads / 2);
+  exh_options.threads = max(1, threads - mh_options.threads);
+  if (not check_trace(trace_file))
+    return 1;
+
+  double start_time = now();
+  if (time_limit > 0)
+    deadline = start_time + time_limit;
+  handle_signals();
+
+  Instance input;
+  try {
+    input = read_instance(input_file);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  double load_time = now() - start_time;
+  cerr << "load time: " << load_time << " s" << endl;
+  TRACE_TIME("parse", load_time);
+
+  // ties are broken by index, as in the next fit order
+  vector<int> rank(input.f);
+  for (int i = 0; i < input.f; ++i)
+    rank[i] = i;
+  vector<Day> plan = dsatur_plan(input, rank), other = rlf_plan(input, rank);
+  string engine = "dsatur";
+  if (other.size() < plan.size()) {
+    swap(plan, other);
+    engine = "rlf";
+  }
+  string text;
+  format_plan(input, title_width(input), plan, plan.size(),
+              now() - start_time, text);
+  incumbent.offer(plan.size(), text, engine);
+  cerr << engine << ": " << plan.size() << " days" << endl;
+
+  heuristic_engine.writer.open([&](int days, const string &output) {
+    incumbent.offer(days, output, "mh");
+  }, input);
+  search_engine.writer.open([&](int days, const string &output) {
+    incumbent.offer(days, output, "exh");
+  }, input);
+  ostringstream mh_report, exh_report;
+  heuristic_engine.report = &mh_report;
+  search_engine.report = &exh_report;
+  Outcome heuristic, search;
+  thread metaheuristic([&] {
+    heuristic = heuristic_engine.solve(input, mh_options, start_time);
+  });
+  search = search_engine.solve(input, exh_options, start_time);
+  metaheuristic.join();
+  print_report("mh", mh_report);
+  print_report("exh", exh_report);
+
+  bool optimal = heuristic.optimal or search.optimal;
+  cerr << "portfolio: " << incumbent.days << " days, found by "
+       << incumbent.engine << " ("
+       << (optimal ? "optimal" : "not proven optimal") << ")" << endl;
+  if (not save_trace(trace_file))
+    return 1;
+}
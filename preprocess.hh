@@ -0,0 +1,290 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Reduction of an instance to a smaller core before the search, and the way
+back from a plan of the core to a plan of the whole instance.
+
+Given a lower bound b of the days of the instance, a plan of D >= b days always
+has room for a film with fewer than t = b - floor((f - 1) / c) conflicts among
+the films already planned: at most floor((f - 1) / c) days are full, so some
+day is neither full nor has a conflict of the film. The reduction removes such
+films over and over (peeling) and puts them back in the reverse order, so the
+core needs as many days as the whole instance, or fewer than b.
+
+A film whose conflicts are all conflicts of another film not in conflict with
+it (it is dominated) is removed too, and put back on the day of that film. The
+dominator is only taken if its day always has a free cinema for it: the films
+that can share that day are the dominator and the films not in conflict with
+it, so it needs at least f - c conflicts. The step is then exact whatever the
+number of cinemas.
+
+The core may then split into components with no restriction between them.
+Their plans can be found apart and merged: days of different components can
+share a day as long as they fit in its cinemas. */
+
+#ifndef PREPROCESS_HH
+#define PREPROCESS_HH
+
+#include <algorithm>
+#include <utility>
+#include <vector>
+
+#include "festival.hh"
+#include "trace.hh"
+using namespace std;
+
+// A film removed by the reduction, and the film that dominates it (or -1).
+struct Removal {
+  int film, dominator;
+};
+
+/* Result of a reduction: the films of the core in increasing order, the films
+removed in the order they were, and the films of each component of the core. */
+struct Reduction {
+  vector<int> core;
+  vector<Removal> removed;
+  vector<vector<int>> components;
+  int peeled = 0, dominated = 0;
+};
+
+// Films are only checked for domination up to this number of conflicts.
+const int max_dominated_degree = 32;
+
+/* Reduces an instance given a lower bound of its days. The peeling runs first
+and again after every dominated film; the films are checked for domination
+from the least conflicting, among the ones that are left. */
+inline Reduction reduce_instance(const Instance &festival, int lower_bound) {
+  TRACE_PHASE("preprocess");
+  int f = festival.f;
+  int threshold = lower_bound - (f - 1) / festival.c;
+  Reduction r;
+  vector<int> degree = festival.num_restrictions;
+  vector<bool> removed(f, false);
+  vector<int> queue;
+
+  auto remove = [&](int film, int dominator) {
+    removed[film] = true;
+    r.removed.push_back({film, dominator});
+    for (int j : festival.neighbours(film))
+      if (not removed[j] and --degree[j] == threshold - 1)
+        queue.push_back(j);
+  };
+  auto peel = [&]() {
+    while (not queue.empty()) {
+      int film = queue.back();
+      queue.pop_back();
+      if (not removed[film]) {
+        remove(film, -1);
+        ++r.peeled;
+      }
+    }
+  };
+
+  for (int i = 0; i < f; ++i)
+    if (degree[i] < threshold)
+      queue.push_back(i);
+  peel();
+
+  /* v is dominated by u if u is not in conflict with v and every conflict of v
+  that is left is a conflict of u: u is searched among the conflicts of the
+  conflict x of v with fewest conflicts. Besides v, the day of u holds at most
+  u and the f - 2 - conflicts(u) other films not in conflict with u, so it has
+  room for v if u has at least f - c conflicts. */
+  int min_dominator_degree = f - festival.c;
+  vector<int> order;
+  for (int i = 0; i < f; ++i)
+    if (not removed[i] and degree[i] <= max_dominated_degree)
+      order.push_back(i);
+  stable_sort(order.begin(), order.end(),
+              [&](int a, int b) { return degree[a] < degree[b]; });
+  for (int v : order) {
+    if (removed[v])
+      continue;
+    int x = -1;
+    for (int j : festival.neighbours(v))
+      if (not removed[j] and (x < 0 or degree[j] < degree[x]))
+        x = j;
+    if (x < 0)
+      continue;
+    int dominator = -1;
+    for (int u : festival.neighbours(x)) {
+      if (u == v or removed[u] or degree[u] < degree[v] or
+          festival.num_restrictions[u] < min_dominator_degree or
+          festival.restricted(u, v))
+        continue;
+      bool covers = true;
+      for (int w : festival.neighbours(v))
+        if (not removed[w] and w != x and not festival.restricted(u, w)) {
+          covers = false;
+          break;
+        }
+      if (covers) {
+        dominator = u;
+        break;
+      }
+    }
+    if (dominator >= 0) {
+      remove(v, dominator);
+      ++r.dominated;
+      peel();
+    }
+  }
+
+  // the components of the core, by a search from each film not reached yet
+  vector<bool> reached(f, false);
+  for (int i = 0; i < f; ++i) {
+    if (removed[i])
+      continue;
+    r.core.push_back(i);
+    if (reached[i])
+      continue;
+    vector<int> component = {i};
+    reached[i] = true;
+    for (int k = 0; k < int(component.size()); ++k)
+      for (int j : festival.neighbours(component[k]))
+        if (not removed[j] and not reached[j]) {
+          reached[j] = true;
+          component.push_back(j);
+        }
+    sort(component.begin(), component.end());
+    r.components.push_back(move(component));
+  }
+  return r;
+}
+
+/* Returns the instance of the restrictions among some films, given in
+increasing order, with the same number of cinemas. Film i of it is films[i].
+The titles and names are left out, as its plans are written with the whole
+instance. */
+inline Instance sub_instance(const Instance &festival,
+                             const vector<int> &films) {
+  thread_local vector<int> local;
+  local.resize(festival.f, -1);
+  Instance sub;
+  sub.f = films.size();
+  sub.c = festival.c;
+  for (int i = 0; i < sub.f; ++i)
+    local[films[i]] = i;
+  vector<pair<int, int>> pairs;
+  for (int i = 0; i < sub.f; ++i)
+    for (int j : festival.neighbours(films[i]))
+      if (j > films[i] and local[j] >= 0)
+        pairs.push_back({i, local[j]});
+  for (int film : films)
+    local[film] = -1;
+  sub.l = pairs.size();
+  build_conflicts(sub, pairs);
+  return sub;
+}
+
+/* Merges the plans of the components of an instance into one plan of c
+cinemas: the days of all of them, largest first, go to the first day of the
+merged plan with room for them and no other day of the same component. */
+inline vector<Day> merge_plans(const vector<vector<Day>> &plans, int c) {
+  vector<pair<int, int>> blocks;
+  for (int k = 0; k < int(plans.size()); ++k)
+    for (int d = 0; d < int(plans[k].size()); ++d)
+      if (not plans[k][d].empty())
+        blocks.push_back({k, d});
+  stable_sort(blocks.begin(), blocks.end(), [&](auto a, auto b) {
+    return plans[a.first][a.second].size() > plans[b.first][b.second].size();
+  });
+
+  vector<Day> merged;
+  // days used by each component, and mark[d] == k if component k uses day d
+  vector<vector<int>> used(plans.size());
+  vector<int> mark;
+  int first_free = 0;
+  for (auto [k, d] : blocks) {
+    const Day &films = plans[k][d];
+    for (int day : used[k])
+      mark[day] = k;
+    while (first_free < int(merged.size()) and
+           int(merged[first_free].size()) == c)
+      ++first_free;
+    int day = first_free;
+    while (day < int(merged.size()) and
+           (mark[day] == k or merged[day].size() + films.size() > size_t(c)))
+      ++day;
+    if (day == int(merged.size())) {
+      merged.emplace_back();
+      mark.push_back(-1);
+    }
+    merged[day].insert(merged[day].end(), films.begin(), films.end());
+    used[k].push_back(day);
+  }
+  return merged;
+}
+
+/* Puts the removed films back into a plan of the core (in films of the whole
+instance), in the reverse order of their removal: a dominated film on the day
+of its dominator if it has a free cinema, and every other one on the first day
+where it fits. The plan gets empty days up to the lower bound first, and loses
+the ones left empty at the end. */
+inline vector<Day> restore_plan(const Instance &festival, const Reduction &r,
+                                vector<Day> plan, int lower_bound) {
+  int f = festival.f, c = festival.c;
+  if (int(plan.size()) < lower_bound)
+    plan.resize(lower_bound);
+  vector<int> day_of(f, -1);
+  for (int d = 0; d < int(plan.size()); ++d)
+    for (int film : plan[d])
+      day_of[film] = d;
+
+  // next_room[d] leads to the first day from d with a free cinema
+  vector<int> next_room(plan.size() + 1), mark(plan.size(), -1);
+  for (int d = 0; d <= int(plan.size()); ++d)
+    next_room[d] = d < int(plan.size()) and int(plan[d].size()) == c ? d + 1
+                                                                      : d;
+  auto first_room = [&](int d) {
+    while (next_room[d] != d) {
+      next_room[d] = next_room[next_room[d]];
+      d = next_room[d];
+    }
+    return d;
+  };
+
+  for (int k = r.removed.size() - 1; k >= 0; --k) {
+    int film = r.removed[k].film, dominator = r.removed[k].dominator;
+    int day = -1;
+    if (dominator >= 0 and int(plan[day_of[dominator]].size()) < c)
+      day = day_of[dominator];
+    else {
+      for (int j : festival.neighbours(film))
+        if (day_of[j] >= 0)
+          mark[day_of[j]] = film;
+      day = first_room(0);
+      while (day < int(plan.size()) and mark[day] == film)
+        day = first_room(day + 1);
+      if (day == int(plan.size())) {
+        plan.emplace_back();
+        mark.push_back(-1);
+        next_room.push_back(plan.size());
+      }
+    }
+    plan[day].push_back(film);
+    day_of[film] = day;
+    if (int(plan[day].size()) == c)
+      next_room[day] = day + 1;
+  }
+  plan.erase(remove_if(plan.begin(), plan.end(),
+                       [](const Day &films) { return films.empty(); }),
+             plan.end());
+  return plan;
+}
+
+/* Returns the plan of the whole instance for plans of the components of its
+core, each given in films of its component: film i of plans[k] is
+r.components[k][i]. */
+inline vector<Day> restore_component_plans(const Instance &festival,
+                                           const Reduction &r,
+                                           vector<vector<Day>> plans,
+                                           int lower_bound) {
+  for (int k = 0; k < int(plans.size()); ++k)
+    for (Day &films : plans[k])
+      for (int &film : films)
+        film = r.components[k][film];
+  return restore_plan(festival, r, merge_plans(plans, festival.c),
+                      lower_bound);
+}
+
+#endif
@@ -0,0 +1,109 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Re-plans a festival after late changes:
+
+  replan input plan delta output [--instance FILE]
+
+reads the instance, a plan of it in the output format and a delta file (see
+replan.hh), and writes to output the plan repaired for the changed instance.
+With --instance, the changed instance is written to FILE in the input format,
+so that the next changes and the solvers can start from it. */
+
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "control.hh"
+#include "festival.hh"
+#include "replan.hh"
+#include "writer.hh"
+using namespace std;
+
+// Writes an instance in the input format.
+void save_instance(const Instance &festival, const string &path) {
+  string text = to_string(festival.f) + '\n';
+  for (const string &title : festival.titles)
+    text += title + '\n';
+  text += to_string(festival.adjacency.size() / 2) + '\n';
+  for (int i = 0; i < festival.f; ++i)
+    for (int j : festival.neighbours(i))
+      if (j > i)
+        text += festival.titles[i] + ' ' + festival.titles[j] + '\n';
+  text += to_string(festival.c) + '\n';
+  for (int i = 0; i < festival.c; ++i)
+    text += (i > 0 ? " " : "") + festival.cinemas[i];
+  text += '\n';
+  ofstream out(path, ios::binary | ios::trunc);
+  out.write(text.data(), text.size());
+  if (not out)
+    throw runtime_error(path + ": cannot write file");
+}
+
+int main(int argc, char **argv) {
+  if (argc < 5) {
+    cerr << "usage: " << argv[0]
+         << " input plan delta output [--instance FILE]" << endl;
+    return 1;
+  }
+  string instance_file;
+  for (int i = 5; i < argc; ++i) {
+    string option = argv[i];
+    if (option == "--instance" and i + 1 < argc)
+      instance_file = argv[++i];
+    else {
+      cerr << "unknown option " << option << endl;
+      return 1;
+    }
+  }
+
+  double start_time = now();
+  Instance old_festival, festival;
+  Placement placement;
+  try {
+    old_festival = read_instance(argv[1]);
+    Placement old_plan = read_plan(old_festival, argv[2]);
+    vector<int> old_film;
+    festival = apply_delta(old_festival, argv[3], old_film);
+
+    // the cinemas are matched by name, as the closed ones leave gaps
+    unordered_map<string, int> cinema_index;
+    for (int i = 0; i < festival.c; ++i)
+      cinema_index[festival.cinemas[i]] = i;
+    placement.day.assign(festival.f, -1);
+    placement.cinema.assign(festival.f, -1);
+    for (int i = 0; i < festival.f; ++i) {
+      int old = old_film[i];
+      if (old < 0 or old_plan.day[old] < 0)
+        continue;
+      placement.day[i] = old_plan.day[old];
+      auto it = cinema_index.find(old_festival.cinemas[old_plan.cinema[old]]);
+      if (it != cinema_index.end())
+        placement.cinema[i] = it->second;
+    }
+    if (not instance_file.empty())
+      save_instance(festival, instance_file);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return 1;
+  }
+  double load_time = now() - start_time;
+  cerr << "load time: " << load_time << " s" << endl;
+
+  int old_days = 0;
+  for (int d : placement.day)
+    old_days = max(old_days, d + 1);
+  Repair result = repair_plan(festival, placement);
+  double repair_time = now() - start_time - load_time;
+
+  Writer writer;
+  writer.open(argv[4], festival);
+  writer.publish(result.plan, result.plan.size(), now() - start_time);
+  writer.close();
+  cerr << "repair time: " << repair_time << " s" << endl;
+  cerr << "films placed: " << result.placed << ", screenings moved: "
+       << result.moved << endl;
+  cerr << "days: " << result.plan.size() << " (before " << old_days << ")"
+       << endl;
+}
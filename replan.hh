@@ -0,0 +1,353 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Re-planning after late changes. A delta file lists changes of an instance,
+one per line:
+
+  add-film TITLE
+  remove-film TITLE
+  add-restriction TITLE TITLE
+  remove-restriction TITLE TITLE
+  open-cinema NAME
+  close-cinema NAME
+
+They are applied in order to the instance, and the plan of the old instance is
+then repaired on the new one: the films left in conflict or over the cinemas of
+their day, and the new ones, are taken out and put back on the days where they
+fit, and the other screenings keep their day and cinema where possible. */
+
+#ifndef REPLAN_HH
+#define REPLAN_HH
+
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+#include "festival.hh"
+using namespace std;
+
+// A plan given by the day and cinema of each film, or -1 if it has none.
+struct Placement {
+  vector<int> day, cinema;
+};
+
+/* Reads a plan of an instance from a file in the output format. Films missing
+from it are left without a day. Throws a runtime_error naming the file and line
+if it is malformed or does not match the instance. */
+inline Placement read_plan(const Instance &festival, const string &path) {
+  File_view file(path);
+  Tokenizer in(file.data(), path);
+  unordered_map<string_view, int> film_index, cinema_index;
+  for (int i = 0; i < festival.f; ++i)
+    film_index[festival.titles[i]] = i;
+  for (int i = 0; i < festival.c; ++i)
+    cinema_index[festival.cinemas[i]] = i;
+
+  Placement placement;
+  placement.day.assign(festival.f, -1);
+  placement.cinema.assign(festival.f, -1);
+  in.next("time");
+  int days = in.next_int("number of days", 1);
+  vector<bool> used(size_t(days) * festival.c, false);
+  while (not in.done()) {
+    string_view title = in.next("film title");
+    auto film = film_index.find(title);
+    if (film == film_index.end())
+      in.fail("unknown film title '" + string(title) + "'");
+    if (placement.day[film->second] >= 0)
+      in.fail("film '" + string(title) + "' planned twice");
+    int day = in.next_int("day", 1) - 1;
+    if (day >= days)
+      in.fail("day " + to_string(day + 1) + " out of range");
+    string_view name = in.next("cinema name");
+    auto cinema = cinema_index.find(name);
+    if (cinema == cinema_index.end())
+      in.fail("unknown cinema '" + string(name) + "'");
+    if (used[size_t(day) * festival.c + cinema->second])
+      in.fail("cinema '" + string(name) + "' used twice on a day");
+    used[size_t(day) * festival.c + cinema->second] = true;
+    placement.day[film->second] = day;
+    placement.cinema[film->second] = cinema->second;
+  }
+  return placement;
+}
+
+/* Applies the changes of a delta, given as the text of a delta file named
+`name` in the error messages, to an instance. The films of the new instance are
+the films of the old one that are left, in the same order, and then the added
+ones; old_film[i] is the film of the old instance that film i of the new one
+was, or -1 if it is new. Throws a runtime_error naming the delta and line if a
+change is malformed or refers to an unknown film or cinema. */
+inline Instance apply_delta(const Instance &festival, string_view data,
+                            const string &name, vector<int> &old_film) {
+  Tokenizer in(data, name);
+
+  /* Films are numbered as in the old instance, and the added ones after them.
+  A pair is the two films of a restriction, the lowest one first. */
+  vector<string> titles = festival.titles;
+  vector<bool> alive(festival.f, true);
+  unordered_map<string, int> index;
+  for (int i = 0; i < festival.f; ++i)
+    index[titles[i]] = i;
+  vector<string> cinemas = festival.cinemas;
+  unordered_set<uint64_t> added, removed;
+  auto pair_of = [](int a, int b) {
+    return uint64_t(min(a, b)) << 32 | uint32_t(max(a, b));
+  };
+  auto old_pair = [&](int a, int b) {
+    return a < festival.f and b < festival.f and festival.restricted(a, b);
+  };
+  auto film = [&]() {
+    string title(in.next("film title"));
+    auto it = index.find(title);
+    if (it == index.end())
+      in.fail("unknown film title '" + title + "'");
+    return it->second;
+  };
+
+  while (not in.done()) {
+    string change(in.next("change"));
+    if (change == "add-film") {
+      string title(in.next("film title"));
+      if (not index.emplace(title, titles.size()).second)
+        in.fail("repeated film title '" + title + "'");
+      titles.push_back(title);
+      alive.push_back(true);
+    } else if (change == "remove-film") {
+      int a = film();
+      alive[a] = false;
+      index.erase(titles[a]);
+    } else if (change == "add-restriction" or change == "remove-restriction") {
+      int a = film(), b = film();
+      if (a == b)
+        in.fail("film '" + titles[a] + "' restricted with itself");
+      uint64_t p = pair_of(a, b);
+      if (change == "add-restriction") {
+        removed.erase(p);
+        if (not old_pair(a, b))
+          added.insert(p);
+      } else {
+        if (not added.count(p) and (not old_pair(a, b) or removed.count(p)))
+          in.fail("films '" + titles[a] + "' and '" + titles[b] +
+                  "' are not restricted");
+        added.erase(p);
+        if (old_pair(a, b))
+          removed.insert(p);
+      }
+    } else if (change == "open-cinema") {
+      string name(in.next("cinema name"));
+      if (find(cinemas.begin(), cinemas.end(), name) != cinemas.end())
+        in.fail("repeated cinema name '" + name + "'");
+      cinemas.push_back(name);
+    } else if (change == "close-cinema") {
+      string name(in.next("cinema name"));
+      auto it = find(cinemas.begin(), cinemas.end(), name);
+      if (it == cinemas.end())
+        in.fail("unknown cinema '" + name + "'");
+      if (cinemas.size() == 1)
+        in.fail("cannot close the last cinema");
+      cinemas.erase(it);
+    } else
+      in.fail("unknown change '" + change + "'");
+  }
+
+  Instance result;
+  vector<int> new_film(titles.size(), -1);
+  old_film.clear();
+  for (int i = 0; i < int(titles.size()); ++i)
+    if (alive[i]) {
+      new_film[i] = result.titles.size();
+      result.titles.push_back(titles[i]);
+      old_film.push_back(i < festival.f ? i : -1);
+    }
+  if (result.titles.empty())
+    throw runtime_error(name + ": no film left");
+  result.f = result.titles.size();
+  result.cinemas = cinemas;
+  result.c = cinemas.size();
+
+  vector<pair<int, int>> pairs;
+  for (int i = 0; i < festival.f; ++i)
+    if (alive[i])
+      for (int j : festival.neighbours(i))
+        if (j > i and alive[j] and not removed.count(pair_of(i, j)))
+          pairs.push_back({new_film[i], new_film[j]});
+  for (uint64_t p : added) {
+    int a = p >> 32, b = p & 0xffffffff;
+    if (alive[a] and alive[b])
+      pairs.push_back({new_film[a], new_film[b]});
+  }
+  result.l = pairs.size();
+  build_conflicts(result, pairs);
+  return result;
+}
+
+// Applies the changes of a delta file to an instance, as above.
+inline Instance apply_delta(const Instance &festival, const string &path,
+                            vector<int> &old_film) {
+  File_view file(path);
+  return apply_delta(festival, file.data(), path, old_film);
+}
+
+/* Result of a repair: the new plan, with a position for every cinema of each
+day and -1 where it is free, how many films of the old plan changed day or
+cinema, and how many films the repair had to place. */
+struct Repair {
+  vector<Day> plan;
+  int moved = 0, placed = 0;
+};
+
+/* Repairs a plan of an instance given the day and cinema each film had (-1 if
+it had none, or its cinema closed). First each day gives up the films in
+conflict with others of the day, the most conflicting first, and the films over
+its cinemas, the ones that lost their cinema first. Then these films and the
+ones without a day, most restricted first, go to the first day where they fit;
+if there is none, a day where they conflict with a single film that fits on
+another day is tried, moving that film, before a new day is opened. The days
+keep their numbers, so the films that stay keep their day: only the empty days
+at the end are removed. Finally the films of each day keep their old cinema if
+it is still there and free, and the others take the free ones. */
+inline Repair repair_plan(const Instance &festival, const Placement &old) {
+  int f = festival.f, c = festival.c;
+  int days = 0;
+  for (int d : old.day)
+    days = max(days, d + 1);
+  vector<int> day_of = old.day;
+  vector<Day> plan(days);
+  for (int i = 0; i < f; ++i)
+    if (day_of[i] >= 0)
+      plan[day_of[i]].push_back(i);
+
+  vector<int> loose, in_day(f, 0);
+  auto unplan = [&](int film) {
+    Day &films = plan[day_of[film]];
+    films.erase(find(films.begin(), films.end(), film));
+    for (int j : festival.neighbours(film))
+      if (day_of[j] == day_of[film])
+        --in_day[j];
+    day_of[film] = -1;
+    loose.push_back(film);
+  };
+
+  for (int i = 0; i < f; ++i) {
+    if (day_of[i] < 0)
+      loose.push_back(i);
+    else
+      for (int j : festival.neighbours(i))
+        if (day_of[j] == day_of[i])
+          ++in_day[i];
+  }
+  for (Day &films : plan) {
+    while (true) {
+      int worst = -1;
+      for (int i : films)
+        if (in_day[i] > 0 and (worst < 0 or in_day[i] > in_day[worst] or
+                               (in_day[i] == in_day[worst] and
+                                festival.num_restrictions[i] >
+                                    festival.num_restrictions[worst])))
+          worst = i;
+      if (worst < 0)
+        break;
+      unplan(worst);
+    }
+    if (int(films.size()) > c) {
+      Day order = films;
+      auto lost = [&](int i) {
+        return old.cinema[i] < 0 or old.cinema[i] >= c;
+      };
+      stable_sort(order.begin(), order.end(),
+                  [&](int a, int b) { return lost(a) > lost(b); });
+      for (int k = 0; int(films.size()) > c; ++k)
+        unplan(order[k]);
+    }
+  }
+
+  Repair result;
+  sort(loose.begin(), loose.end(), [&](int a, int b) {
+    return festival.num_restrictions[a] > festival.num_restrictions[b];
+  });
+  vector<int> mark(plan.size(), -1), conflict(plan.size());
+  auto fits = [&](int film, int day) {
+    for (int j : festival.neighbours(film))
+      if (day_of[j] == day)
+        return false;
+    return int(plan[day].size()) < c;
+  };
+  auto place = [&](int film, int day) {
+    plan[day].push_back(film);
+    day_of[film] = day;
+  };
+  for (int film : loose) {
+    ++result.placed;
+    // conflict[d] is the film in conflict on day d if there is a single one
+    for (int j : festival.neighbours(film))
+      if (day_of[j] >= 0) {
+        int d = day_of[j];
+        conflict[d] = mark[d] == film ? -1 : j;
+        mark[d] = film;
+      }
+    int day = 0;
+    while (day < int(plan.size()) and
+           (mark[day] == film or int(plan[day].size()) == c))
+      ++day;
+    if (day < int(plan.size())) {
+      place(film, day);
+      continue;
+    }
+
+    bool done = false;
+    for (int d = 0; d < int(plan.size()) and not done; ++d) {
+      int j = mark[d] == film ? conflict[d] : -1;
+      if (j < 0)
+        continue;
+      for (int e = 0; e < int(plan.size()) and not done; ++e)
+        if (e != d and fits(j, e)) {
+          Day &films = plan[d];
+          films.erase(find(films.begin(), films.end(), j));
+          place(j, e);
+          place(film, d);
+          done = true;
+        }
+    }
+    if (not done) {
+      plan.emplace_back();
+      mark.push_back(-1);
+      conflict.push_back(-1);
+      place(film, plan.size() - 1);
+    }
+  }
+
+  // each film takes its old cinema if it can, and the empty last days go
+  while (not plan.empty() and plan.back().empty())
+    plan.pop_back();
+  for (int day = 0; day < int(plan.size()); ++day) {
+    Day arranged(c, -1);
+    vector<int> rest;
+    for (int i : plan[day]) {
+      int k = old.cinema[i];
+      if (old.day[i] == day and k >= 0 and k < c and arranged[k] < 0)
+        arranged[k] = i;
+      else
+        rest.push_back(i);
+    }
+    int next = 0;
+    for (int i : rest) {
+      while (arranged[next] >= 0)
+        ++next;
+      arranged[next] = i;
+      if (old.day[i] >= 0)
+        ++result.moved;
+    }
+    // the free cinemas after the last film are left out
+    while (not arranged.empty() and arranged.back() < 0)
+      arranged.pop_back();
+    result.plan.push_back(move(arranged));
+  }
+  return result;
+}
+
+#endif
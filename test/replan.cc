@@ -0,0 +1,107 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Checks that a repair only moves the screenings a change forces to move:
+
+  g++ -O2 -I. -o replan_test test/replan.cc && ./replan_test
+
+Each case repairs a plan after a delta and fails if a film the delta leaves
+alone changes day or cinema. */
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "festival.hh"
+#include "replan.hh"
+using namespace std;
+
+// Six films, A to F, of which only A and F are restricted, in three cinemas.
+const string instance_text = "6\nA\nB\nC\nD\nE\nF\n1\nA F\n3\nX Y Z\n";
+
+int failures = 0;
+
+void expect(bool condition, const string &what) {
+  if (not condition) {
+    cerr << "FAILED: " << what << endl;
+    ++failures;
+  }
+}
+
+/* Repairs a plan given the day and cinema of each film after a delta, and
+returns where each film of the new instance ended up. */
+Placement repaired(const Placement &old_plan, const string &delta,
+                   Instance &festival, Repair &result) {
+  Instance old_festival = parse_instance(instance_text, "instance");
+  vector<int> old_film;
+  festival = apply_delta(old_festival, delta, "delta", old_film);
+  Placement before, after;
+  before.day.assign(festival.f, -1);
+  before.cinema.assign(festival.f, -1);
+  for (int i = 0; i < festival.f; ++i) {
+    before.day[i] = old_plan.day[old_film[i]];
+    before.cinema[i] = old_plan.cinema[old_film[i]];
+  }
+  result = repair_plan(festival, before);
+  after.day.assign(festival.f, -1);
+  after.cinema.assign(festival.f, -1);
+  for (int d = 0; d < int(result.plan.size()); ++d)
+    for (int k = 0; k < int(result.plan[d].size()); ++k)
+      if (result.plan[d][k] >= 0) {
+        after.day[result.plan[d][k]] = d;
+        after.cinema[result.plan[d][k]] = k;
+      }
+  return after;
+}
+
+// Returns the film of the new instance with a title.
+int film(const Instance &festival, const string &title) {
+  for (int i = 0; i < festival.f; ++i)
+    if (festival.titles[i] == title)
+      return i;
+  return -1;
+}
+
+/* A new restriction between two films of a day moves one of them, and no other
+screening: the film left on the day keeps its cinema. */
+void restriction_added() {
+  // day 1: A B C, day 2: D E, day 3: F
+  Placement old_plan = {{0, 0, 0, 1, 1, 2}, {0, 1, 2, 0, 1, 0}};
+  Instance festival;
+  Repair result;
+  Placement after =
+      repaired(old_plan, "add-restriction A B\n", festival, result);
+  expect(result.moved == 1, "one screening moved after add-restriction");
+  int stayed = 0;
+  for (int i = 0; i < festival.f; ++i)
+    stayed += after.day[i] == old_plan.day[i] and
+              after.cinema[i] == old_plan.cinema[i];
+  expect(stayed == festival.f - 1,
+         "every other screening kept its day and cinema");
+  expect(after.day[film(festival, "A")] != after.day[film(festival, "B")],
+         "A and B on different days");
+}
+
+/* A day left empty by a removed film keeps its number, so the films of the
+later days keep theirs. */
+void day_emptied() {
+  // day 1: A, day 2: B, day 3: C D E, day 4: F
+  Placement old_plan = {{0, 1, 2, 2, 2, 3}, {0, 0, 2, 1, 0, 0}};
+  Instance festival;
+  Repair result;
+  Placement after = repaired(old_plan, "remove-film B\n", festival, result);
+  expect(result.moved == 0, "no screening moved after remove-film");
+  for (string title : {"A", "C", "D", "E", "F"}) {
+    int i = film(festival, title), old = title[0] - 'A';
+    expect(after.day[i] == old_plan.day[old] and
+               after.cinema[i] == old_plan.cinema[old],
+           title + " kept its day and cinema");
+  }
+}
+
+int main() {
+  restriction_added();
+  day_emptied();
+  if (failures > 0)
+    return 1;
+  cerr << "replan: all cases passed" << endl;
+}
@@ -0,0 +1,239 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Instrumentation of the solvers: counters, the time spent in each phase, the
+timeline of the improved plans and samples of values taken during the search
+(such as temperatures). It is compiled out unless FESTIVAL_TRACE is defined
+(g++ -DFESTIVAL_TRACE): the TRACE_ macros expand to nothing, so the release
+builds pay nothing for it.
+
+In a trace build the solvers take --trace FILE and write everything there when
+they finish, as JSON if FILE ends in .json and as CSV otherwise, one line per
+value with the columns kind, name, time and value. Times are seconds since the
+start of the process.
+
+  TRACE_COUNTER(var, "name")  defines a counter at namespace scope;
+  TRACE_COUNT(var)            adds one to it, without locks;
+  TRACE_TOTAL("name", n)      adds n to the counter of that name (with a lock,
+                              for totals added once per thread);
+  TRACE_PHASE("name")         adds the time until the end of the scope to the
+                              phase of that name;
+  TRACE_TIME("name", seconds) adds the seconds measured by the solver to it;
+  TRACE_IMPROVEMENT(days)     records that a plan of that many days was found;
+  TRACE_SAMPLE("name", value) records a value of the search. */
+
+#ifndef TRACE_HH
+#define TRACE_HH
+
+#include <atomic>
+#include <cstdio>
+#include <iostream>
+#include <map>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "control.hh"
+using namespace std;
+
+#ifdef FESTIVAL_TRACE
+
+const bool trace_compiled = true;
+
+struct Trace_counter;
+
+class Trace {
+public:
+  void total(const string &name, long long n) {
+    lock_guard<mutex> guard(lock);
+    totals[name] += n;
+  }
+
+  void phase(const string &name, double seconds) {
+    lock_guard<mutex> guard(lock);
+    phases[name] += seconds;
+  }
+
+  void improvement(int days) {
+    lock_guard<mutex> guard(lock);
+    improvements.push_back({now() - start, days});
+  }
+
+  void sample(const char *name, double value) {
+    lock_guard<mutex> guard(lock);
+    samples.push_back({now() - start, name, value});
+  }
+
+  // Registers a counter, which must live until the trace is saved.
+  void add_counter(Trace_counter *counter) {
+    lock_guard<mutex> guard(lock);
+    counters.push_back(counter);
+  }
+
+  void save(const string &path);
+
+private:
+  struct Improvement {
+    double time;
+    int days;
+  };
+  struct Sample {
+    double time;
+    const char *name;
+    double value;
+  };
+
+  double start = now();
+  mutex lock;
+  vector<Trace_counter *> counters;
+  map<string, long long> totals;
+  map<string, double> phases;
+  vector<Improvement> improvements;
+  vector<Sample> samples;
+};
+
+inline Trace &trace() {
+  static Trace instance;
+  return instance;
+}
+
+// Counter updated without locks, on its own cache line.
+struct alignas(64) Trace_counter {
+  const char *name;
+  atomic<long long> value{0};
+
+  explicit Trace_counter(const char *name) : name(name) {
+    trace().add_counter(this);
+  }
+};
+
+// Adds the time from its construction to its destruction to a phase.
+class Trace_timer {
+public:
+  explicit Trace_timer(const char *name) : name(name), start(now()) {}
+  ~Trace_timer() { trace().phase(name, now() - start); }
+
+private:
+  const char *name;
+  double start;
+};
+
+/* Writes the trace to a file, as JSON if its name ends in .json and as CSV
+otherwise. Throws a runtime_error if the file cannot be written. */
+inline void Trace::save(const string &path) {
+  lock_guard<mutex> guard(lock);
+  map<string, long long> values = totals;
+  for (Trace_counter *counter : counters)
+    values[counter->name] += counter->value;
+
+  bool json =
+      path.size() >= 5 and path.compare(path.size() - 5, 5, ".json") == 0;
+  string text;
+  char number[64];
+  auto real = [&](double x) {
+    snprintf(number, sizeof number, "%.6g", x);
+    return string(number);
+  };
+  if (json) {
+    string separator;
+    text += "{\n  \"counters\": {";
+    for (const auto &[name, value] : values) {
+      text += separator + "\n    \"" + name + "\": " + to_string(value);
+      separator = ",";
+    }
+    text += "\n  },\n  \"phases\": {";
+    separator = "";
+    for (const auto &[name, seconds] : phases) {
+      text += separator + "\n    \"" + name + "\": " + real(seconds);
+      separator = ",";
+    }
+    text += "\n  },\n  \"improvements\": [";
+    separator = "";
+    for (const Improvement &i : improvements) {
+      text += separator + "\n    {\"time\": " + real(i.time) +
+              ", \"days\": " + to_string(i.days) + "}";
+      separator = ",";
+    }
+    text += "\n  ],\n  \"samples\": [";
+    separator = "";
+    for (const Sample &s : samples) {
+      text += separator + "\n    {\"time\": " + real(s.time) +
+              ", \"name\": \"" + s.name + "\", \"value\": " + real(s.value) +
+              "}";
+      separator = ",";
+    }
+    text += "\n  ]\n}\n";
+  } else {
+    text += "kind,name,time,value\n";
+    for (const auto &[name, value] : values)
+      text += "counter," + name + ",," + to_string(value) + '\n';
+    for (const auto &[name, seconds] : phases)
+      text += "phase," + name + ",," + real(seconds) + '\n';
+    for (const Improvement &i : improvements)
+      text += "improvement,days," + real(i.time) + ',' + to_string(i.days) +
+              '\n';
+    for (const Sample &s : samples)
+      text += string("sample,") + s.name + ',' + real(s.time) + ',' +
+              real(s.value) + '\n';
+  }
+
+  FILE *out = fopen(path.c_str(), "w");
+  bool written = out != nullptr and
+                 fwrite(text.data(), 1, text.size(), out) == text.size();
+  if (out != nullptr and fclose(out) != 0)
+    written = false;
+  if (not written)
+    throw runtime_error(path + ": cannot write trace");
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_COUNTER(var, name) inline Trace_counter var(name)
+#define TRACE_COUNT(var) var.value.fetch_add(1, memory_order_relaxed)
+#define TRACE_TOTAL(name, n) trace().total(name, n)
+#define TRACE_PHASE(name)                                                      \
+  Trace_timer TRACE_CONCAT(trace_timer_, __LINE__)(name)
+#define TRACE_TIME(name, seconds) trace().phase(name, seconds)
+#define TRACE_IMPROVEMENT(days) trace().improvement(days)
+#define TRACE_SAMPLE(name, value) trace().sample(name, value)
+#define TRACE_SAVE(path) trace().save(path)
+
+#else
+
+const bool trace_compiled = false;
+
+#define TRACE_COUNTER(var, name)
+#define TRACE_COUNT(var) ((void)0)
+#define TRACE_TOTAL(name, n) ((void)0)
+#define TRACE_PHASE(name)
+#define TRACE_TIME(name, seconds) ((void)0)
+#define TRACE_IMPROVEMENT(days) ((void)0)
+#define TRACE_SAMPLE(name, value) ((void)0)
+#define TRACE_SAVE(path) ((void)0)
+
+#endif
+
+/* Writes the trace to a file if one was asked for. Returns false, after
+reporting why, if it cannot be written. */
+inline bool save_trace(const string &path) {
+  if (path.empty())
+    return true;
+  try {
+    TRACE_SAVE(path);
+  } catch (const exception &e) {
+    cerr << e.what() << endl;
+    return false;
+  }
+  return true;
+}
+
+/* Returns false, after reporting why, if a trace is asked for in a build
+without FESTIVAL_TRACE. */
+inline bool check_trace(const string &path) {
+  if (path.empty() or trace_compiled)
+    return true;
+  cerr << "--trace needs a build with -DFESTIVAL_TRACE" << endl;
+  return false;
+}
+
+#endif
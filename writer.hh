@@ -0,0 +1,181 @@
+// Authors: Sergio Cárdenas & Adrián Cerezuela
+
+/* Background writer of the output file. The solvers publish every improved
+plan and go on searching: a thread writes the latest one to a temporary file and
+renames it over the output, so the file always holds a complete plan, and a
+burst of improvements becomes at most one write per interval. The plans can go
+to a sink instead of a file, such as the connection of a client of the
+daemon or the incumbent of the portfolio. */
+
+#ifndef WRITER_HH
+#define WRITER_HH
+
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "festival.hh"
+#include "trace.hh"
+using namespace std;
+
+// Returns the width of the title column of the plans of an instance.
+inline int title_width(const Instance &festival) {
+  int width = 0;
+  for (const string &title : festival.titles)
+    width = max(width, int(title.size()));
+  return width + 3;
+}
+
+/* Puts in text a plan of `days` days found `time` seconds after the start, in
+the output format, skipping the free cinemas of its days. The text is cleared
+first, so that its memory is reused. */
+inline void format_plan(const Instance &festival, int width,
+                        const vector<Day> &plan, int days, double time,
+                        string &text) {
+  char seconds[32];
+  snprintf(seconds, sizeof seconds, "%.1f\n", time);
+  text = seconds;
+  text += to_string(days) + '\n';
+  for (int i = 0; i < int(plan.size()); ++i) {
+    string day = to_string(i + 1);
+    for (int j = 0; j < int(plan[i].size()); ++j) {
+      if (plan[i][j] < 0)
+        continue;
+      const string &title = festival.titles[plan[i][j]];
+      text += title;
+      text.append(width - title.size(), ' ');
+      text += day;
+      text += "    ";
+      text += festival.cinemas[j];
+      text += '\n';
+    }
+  }
+}
+
+/* Writes a text to a temporary file and renames it over a file, so that the
+file always holds a whole text. Returns false if it cannot be written. */
+inline bool replace_file(const string &path, const string &text) {
+  string temporary = path + ".tmp";
+  ofstream out(temporary, ios::binary | ios::trunc);
+  out.write(text.data(), text.size());
+  out.close();
+  return out and rename(temporary.c_str(), path.c_str()) == 0;
+}
+
+class Writer {
+public:
+  ~Writer() { close(); }
+
+  /* Starts writing to a file the plans of an instance, at most one every
+  `interval` seconds. The instance must outlive the writer or its close(). */
+  void open(const string &path, const Instance &festival,
+            double interval = 0.05) {
+    output_file = path;
+    sink = nullptr;
+    start(festival, interval);
+  }
+
+  /* Starts handing the plans of an instance to a sink, with their days and in
+  the output format, instead of writing them to a file. The sink is called from
+  the thread of the writer. */
+  void open(function<void(int, const string &)> sink, const Instance &festival,
+            double interval = 0.05) {
+    output_file.clear();
+    this->sink = move(sink);
+    start(festival, interval);
+  }
+
+  /* Takes a plan of `days` days found `time` seconds after the start to be
+  written. It only waits for the writer to hand over the previous plan, never
+  for the disk; a plan still waiting to be written is replaced. */
+  void publish(vector<Day> plan, int days, double time) {
+    TRACE_IMPROVEMENT(days);
+    lock_guard<mutex> guard(lock);
+    pending.plan = move(plan);
+    pending.days = days;
+    pending.time = time;
+    has_pending = true;
+    changed.notify_one();
+  }
+
+  // Writes the last plan published, if any is left, and stops the thread.
+  void close() {
+    if (not worker.joinable())
+      return;
+    {
+      lock_guard<mutex> guard(lock);
+      stopping = true;
+      changed.notify_one();
+    }
+    worker.join();
+  }
+
+private:
+  struct Snapshot {
+    vector<Day> plan;
+    int days = 0;
+    double time = 0;
+  };
+
+  void start(const Instance &festival, double interval) {
+    this->festival = &festival;
+    this->interval = chrono::duration<double>(interval);
+    // the width of the title column is the same for every plan
+    max_spaces = title_width(festival);
+    stopping = false;
+    last_write = chrono::steady_clock::now() - chrono::hours(1);
+    worker = thread(&Writer::run, this);
+  }
+
+  void run() {
+    unique_lock<mutex> guard(lock);
+    while (true) {
+      changed.wait(guard, [&] { return has_pending or stopping; });
+      if (not has_pending)
+        return;
+      // waits for the end of the interval, unless the writer is closing
+      changed.wait_until(guard, last_write + interval, [&] { return stopping; });
+      Snapshot snapshot = move(pending);
+      has_pending = false;
+      guard.unlock();
+      save(snapshot);
+      last_write = chrono::steady_clock::now();
+      guard.lock();
+    }
+  }
+
+  /* Writes a plan in the output format to a temporary file, and renames it
+  over the output file, or hands it to the sink. */
+  void save(const Snapshot &snapshot) {
+    TRACE_PHASE("write");
+    format_plan(*festival, max_spaces, snapshot.plan, snapshot.days,
+                snapshot.time, text);
+    if (sink)
+      sink(snapshot.days, text);
+    else if (not replace_file(output_file, text))
+      cerr << "cannot write " << output_file << endl;
+  }
+
+  string output_file;
+  function<void(int, const string &)> sink;
+  const Instance *festival = nullptr;
+  chrono::duration<double> interval;
+  int max_spaces = 0;
+  string text;
+
+  mutex lock;
+  condition_variable changed;
+  Snapshot pending;
+  bool has_pending = false, stopping = false;
+  chrono::steady_clock::time_point last_write;
+  thread worker;
+};
+
+#endif